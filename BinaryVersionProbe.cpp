@@ -0,0 +1,111 @@
+#include "BinaryVersionProbe.hpp"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QProcess>
+#include <QTimer>
+
+#if !_WIN32
+#include <sys/stat.h>
+#endif
+
+/* Identifies a specific build of a file; empty if the file doesn't exist */
+static QString IdentityKey(const QString& path) {
+  const QFileInfo info(path);
+  if (!info.isFile())
+    return {};
+
+  quint64 inode = 0;
+#if !_WIN32
+  struct stat st = {};
+  if (::stat(QFile::encodeName(path).constData(), &st) == 0)
+    inode = quint64(st.st_ino);
+#endif
+  return QStringLiteral("%1:%2:%3").arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch()).arg(inode);
+}
+
+// Same limit the blocking waitForFinished() used to apply
+constexpr int ProbeTimeoutMsec = 30000;
+
+BinaryVersionProbe::BinaryVersionProbe(QObject* parent) : QObject(parent) {}
+
+QStringList BinaryVersionProbe::binaryPaths(const QString& workingDir) {
+  const QString dir = QCoreApplication::applicationDirPath();
+#if _WIN32
+  QString urdePath = dir + QStringLiteral("/urde.exe");
+  QString heclPath = dir + QStringLiteral("/hecl.exe");
+  QString visigenPath = dir + QStringLiteral("/visigen.exe");
+  if (!QFileInfo::exists(urdePath) || !QFileInfo::exists(heclPath) || !QFileInfo::exists(visigenPath)) {
+    urdePath = workingDir + QStringLiteral("/urde.exe");
+    heclPath = workingDir + QStringLiteral("/hecl.exe");
+    visigenPath = workingDir + QStringLiteral("/visigen.exe");
+  }
+#else
+  Q_UNUSED(workingDir);
+  QString urdePath = dir + QStringLiteral("/urde");
+  QString heclPath = dir + QStringLiteral("/hecl");
+  QString visigenPath = dir + QStringLiteral("/visigen");
+#endif
+  return {QFileInfo(urdePath).absoluteFilePath(), QFileInfo(heclPath).absoluteFilePath(),
+          QFileInfo(visigenPath).absoluteFilePath()};
+}
+
+void BinaryVersionProbe::probe(const QStringList& paths) {
+  const quint64 generation = ++m_generation;
+  m_results = QVector<Result>(paths.size());
+  m_outstanding = 0;
+
+  for (int i = 0; i < paths.size(); ++i) {
+    const QString& path = paths[i];
+    const QString key = IdentityKey(path);
+    if (key.isEmpty()) {
+      m_results[i] = Result{path, false, {}};
+      continue;
+    }
+    const auto cached = m_cache.constFind(path);
+    if (cached != m_cache.cend() && cached->first == key) {
+      m_results[i] = cached->second;
+      continue;
+    }
+
+    ++m_outstanding;
+    auto* proc = new QProcess(this);
+    // A binary that hangs counts as present but unversioned, and is probed again next time
+    auto* timeout = new QTimer(proc);
+    timeout->setSingleShot(true);
+    connect(timeout, &QTimer::timeout, proc, &QProcess::kill);
+    connect(proc, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this,
+            [this, proc, timeout, path, key, generation, i](int exitCode, QProcess::ExitStatus status) {
+              Result result{path, true, {}};
+              const bool timedOut = status == QProcess::CrashExit && !timeout->isActive();
+              timeout->stop();
+              if (exitCode == 100 && status == QProcess::NormalExit)
+                result.dlPackage = QString::fromUtf8(proc->readLine()).trimmed();
+              if (!timedOut)
+                m_cache.insert(path, qMakePair(key, result));
+              proc->deleteLater();
+              complete(generation, i, result);
+            });
+    connect(proc, &QProcess::errorOccurred, this, [this, proc, path, generation, i](QProcess::ProcessError error) {
+      // Other errors are followed by finished()
+      if (error != QProcess::FailedToStart)
+        return;
+      proc->deleteLater();
+      complete(generation, i, Result{path, false, {}});
+    });
+    proc->start(path, {QStringLiteral("--dlpackage")}, QIODevice::ReadOnly);
+    timeout->start(ProbeTimeoutMsec);
+  }
+
+  if (m_outstanding == 0)
+    emit probed(m_results);
+}
+
+void BinaryVersionProbe::complete(quint64 generation, int index, const Result& result) {
+  if (generation != m_generation)
+    return;
+  m_results[index] = result;
+  if (--m_outstanding == 0)
+    emit probed(m_results);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * Runs `<binary> --dlpackage` for a set of binaries concurrently and reports the package
+ * string each one was built from. Results are cached per (path, size, mtime, inode), so
+ * binaries that haven't changed since the last probe are never executed again.
+ */
+class BinaryVersionProbe : public QObject {
+  Q_OBJECT
+
+public:
+  struct Result {
+    QString path;
+    bool found = false; // binary could be started
+    QString dlPackage;  // empty if the binary didn't report one
+  };
+
+  explicit BinaryVersionProbe(QObject* parent = Q_NULLPTR);
+
+  // Absolute paths of urde, hecl and visigen, in that order, as used with `workingDir`
+  static QStringList binaryPaths(const QString& workingDir);
+
+  // Supersedes any probe still in flight; only the latest request emits probed()
+  void probe(const QStringList& paths);
+
+signals:
+  void probed(const QVector<BinaryVersionProbe::Result>& results);
+
+private:
+  void complete(quint64 generation, int index, const Result& result);
+
+  QHash<QString, QPair<QString, Result>> m_cache; // path -> (identity key, result)
+  QVector<Result> m_results;
+  quint64 m_generation = 0;
+  int m_outstanding = 0;
+};
@@ -0,0 +1,297 @@
+#include "ConsoleLog.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include <QDir>
+
+namespace {
+constexpr qint64 MinCapacity = 64 * 1024;
+// Average line of the hecl log is ~80 bytes; these leave headroom for short and colorful lines
+constexpr quint64 BytesPerRun = 16;
+constexpr quint64 BytesPerLine = 16;
+constexpr qint64 SpillCopyBufSize = 1024 * 1024;
+
+bool IsHighSurrogate(char16_t c) { return c >= 0xD800 && c < 0xDC00; }
+bool IsLowSurrogate(char16_t c) { return c >= 0xDC00 && c < 0xE000; }
+} // namespace
+
+ConsoleLog::ConsoleLog(qint64 capacityBytes, qint64 spillBytes) { setCapacity(capacityBytes, spillBytes); }
+
+void ConsoleLog::setCapacity(qint64 capacityBytes, qint64 spillBytes) {
+  // Every byte of text brings its share of runs and line index entries, all within the capacity
+  const quint64 capacity = quint64(std::max(capacityBytes, MinCapacity));
+  const quint64 textBytes = capacity * BytesPerRun * BytesPerLine /
+                            (BytesPerRun * BytesPerLine + sizeof(Run) * BytesPerLine + sizeof(Line) * BytesPerRun);
+  m_bytes.assign(textBytes, 0);
+  m_bytes.shrink_to_fit();
+  m_runs.assign(textBytes / BytesPerRun, Run{});
+  m_runs.shrink_to_fit();
+  m_maxLines = textBytes / BytesPerLine;
+  m_spillCapacity = std::max<qint64>(spillBytes, 0);
+  clear();
+}
+
+void ConsoleLog::clear() {
+  m_lines.clear();
+  m_byteTail = 0;
+  m_runTail = 0;
+  m_firstLineNumber = 0;
+  m_maxColumns = 0;
+  m_tail.resize(1);
+  m_tail.front().chars.clear();
+  m_tail.front().formats.clear();
+  m_row = 0;
+  m_column = 0;
+  m_spill.reset();
+  m_oldSpill.reset();
+  m_spillLines = 0;
+  m_oldSpillLines = 0;
+  m_droppedLines = 0;
+}
+
+qint64 ConsoleLog::memoryUsage() const {
+  qint64 usage = qint64(m_bytes.capacity() + m_runs.capacity() * sizeof(Run) + m_lines.size() * sizeof(Line) +
+                        m_scratch.capacity());
+  for (const TailLine& line : m_tail)
+    usage += qint64(sizeof(TailLine) + line.chars.capacity() * sizeof(char16_t) +
+                    line.formats.capacity() * sizeof(int));
+  return usage;
+}
+
+void ConsoleLog::text(const QChar* data, int len, int format) {
+  TailLine& line = m_tail[m_row];
+  const size_t end = m_column + size_t(len);
+  if (end > line.chars.size()) {
+    line.chars.resize(end);
+    line.formats.resize(end);
+  }
+  const auto* chars = reinterpret_cast<const char16_t*>(data);
+  std::copy(chars, chars + len, line.chars.begin() + m_column);
+  std::fill(line.formats.begin() + m_column, line.formats.begin() + end, format);
+  m_column = end;
+  m_maxColumns = std::max(m_maxColumns, int(line.chars.size()));
+}
+
+void ConsoleLog::carriageReturn() { m_column = 0; }
+
+void ConsoleLog::lineFeed() {
+  m_column = 0;
+  if (++m_row < m_tail.size())
+    return;
+  if (m_tail.size() < size_t(TailLines)) {
+    m_tail.emplace_back();
+  } else {
+    commitFrontTail();
+    --m_row;
+  }
+}
+
+void ConsoleLog::cursorUp(int lines) {
+  // Lines that already left the grid are final; the cursor stops at its top. Every line moved
+  // over is cleared, so a shorter redraw leaves nothing of the previous one behind
+  const size_t row = m_row - std::min(m_row, size_t(std::max(lines, 0)));
+  for (size_t i = row; i < m_row; ++i) {
+    m_tail[i].chars.clear();
+    m_tail[i].formats.clear();
+  }
+  m_row = row;
+  m_column = 0;
+}
+
+void ConsoleLog::flushTail() {
+  // Empty lines from the cursor down are where output would have continued, not content
+  size_t count = m_tail.size();
+  while (count > m_row && m_tail[count - 1].chars.empty())
+    --count;
+  for (size_t i = 0; i < count; ++i)
+    commitLine(m_tail[i]);
+  m_tail.resize(1);
+  m_tail.front().chars.clear();
+  m_tail.front().formats.clear();
+  m_row = 0;
+  m_column = 0;
+}
+
+void ConsoleLog::commitFrontTail() {
+  // Recycles the line's buffers as the new last line of the grid
+  TailLine line = std::move(m_tail.front());
+  m_tail.pop_front();
+  commitLine(line);
+  line.chars.clear();
+  line.formats.clear();
+  m_tail.push_back(std::move(line));
+}
+
+void ConsoleLog::commitLine(const TailLine& tailLine) {
+  // Measure first so the line lands in the ring in one piece; overlong lines are truncated
+  const std::vector<char16_t>& chars = tailLine.chars;
+  const std::vector<int>& formats = tailLine.formats;
+  const size_t count = chars.size();
+  quint64 bytes = 0;
+  quint64 runs = 0;
+  size_t end = 0;
+  for (int prevFormat = -1; end < count;) {
+    const char16_t c = chars[end];
+    size_t units = 1;
+    quint64 charBytes = 3;
+    if (c < 0x80) {
+      charBytes = 1;
+    } else if (c < 0x800) {
+      charBytes = 2;
+    } else if (IsHighSurrogate(c) && end + 1 < count && IsLowSurrogate(chars[end + 1])) {
+      units = 2;
+      charBytes = 4;
+    }
+    const bool newRun = formats[end] != prevFormat;
+    if (bytes + charBytes > m_bytes.size() || runs + newRun > m_runs.size())
+      break;
+    bytes += charBytes;
+    runs += newRun;
+    prevFormat = formats[end];
+    end += units;
+  }
+
+  reserve(bytes, runs);
+  Line line{m_byteTail, m_runTail, quint32(bytes), quint32(runs)};
+  const quint64 byteCap = m_bytes.size();
+  const quint64 runCap = m_runs.size();
+  const auto put = [&](uchar b) { m_bytes[(m_byteTail++) % byteCap] = char(b); };
+  for (size_t i = 0; i < end; ++i) {
+    if (i == 0 || formats[i] != formats[i - 1])
+      m_runs[(m_runTail++) % runCap] = Run{quint32(m_byteTail - line.bytePos), quint32(formats[i])};
+    quint32 c = chars[i];
+    if (c < 0x80) {
+      put(uchar(c));
+    } else if (c < 0x800) {
+      put(uchar(0xC0 | (c >> 6)));
+      put(uchar(0x80 | (c & 0x3F)));
+    } else {
+      if (IsHighSurrogate(char16_t(c)) && i + 1 < end && IsLowSurrogate(chars[i + 1])) {
+        c = 0x10000 + ((c - 0xD800) << 10) + (chars[++i] - 0xDC00);
+        put(uchar(0xF0 | (c >> 18)));
+        put(uchar(0x80 | ((c >> 12) & 0x3F)));
+      } else {
+        // Unpaired surrogates are encoded as-is rather than dropped
+        put(uchar(0xE0 | (c >> 12)));
+      }
+      put(uchar(0x80 | ((c >> 6) & 0x3F)));
+      put(uchar(0x80 | (c & 0x3F)));
+    }
+  }
+  m_lines.push_back(line);
+}
+
+bool ConsoleLog::reserve(quint64 bytes, quint64 runs) {
+  while (!m_lines.empty() && (m_byteTail + bytes - m_lines.front().bytePos > m_bytes.size() ||
+                              m_runTail + runs - m_lines.front().runPos > m_runs.size() ||
+                              m_lines.size() >= m_maxLines))
+    evictFront();
+  return bytes <= m_bytes.size() && runs <= m_runs.size();
+}
+
+void ConsoleLog::evictFront() {
+  const Line& line = m_lines.front();
+  m_scratch.resize(line.byteLen + 1);
+  copyOut(line.bytePos, line.byteLen, m_scratch.data());
+  m_scratch[line.byteLen] = '\n';
+  if (!writeSpill(m_scratch.data(), qint64(m_scratch.size())))
+    ++m_droppedLines;
+  m_lines.pop_front();
+  ++m_firstLineNumber;
+}
+
+bool ConsoleLog::writeSpill(const char* data, qint64 len) {
+  if (m_spillCapacity == 0)
+    return false;
+  if (m_spill && m_spill->pos() + len > m_spillCapacity / 2) {
+    // Rotate rather than grow: the older half of the spill goes
+    m_droppedLines += m_oldSpillLines;
+    m_oldSpill = std::move(m_spill);
+    m_oldSpillLines = std::exchange(m_spillLines, 0);
+  }
+  if (!m_spill && !m_spillFailed) {
+    m_spill = std::make_unique<QTemporaryFile>(QDir::temp().filePath(QStringLiteral("hecl-gui-console-XXXXXX.log")));
+    if (!m_spill->open()) {
+      m_spill.reset();
+      m_spillFailed = true;
+    }
+  }
+  if (!m_spill || m_spill->write(data, len) != len)
+    return false;
+  ++m_spillLines;
+  return true;
+}
+
+void ConsoleLog::copyOut(quint64 pos, quint32 len, char* dst) const {
+  const size_t start = size_t(pos % m_bytes.size());
+  const size_t first = std::min<size_t>(len, m_bytes.size() - start);
+  std::memcpy(dst, m_bytes.data() + start, first);
+  std::memcpy(dst + first, m_bytes.data(), len - first);
+}
+
+void ConsoleLog::lineSpans(int index, QVector<Span>& out) const {
+  out.clear();
+  if (size_t(index) >= m_lines.size()) {
+    const TailLine& line = m_tail[size_t(index) - m_lines.size()];
+    const auto* chars = reinterpret_cast<const QChar*>(line.chars.data());
+    for (size_t begin = 0, i = 1; begin < line.chars.size(); ++i) {
+      if (i == line.chars.size() || line.formats[i] != line.formats[begin]) {
+        out.push_back({QString(chars + begin, int(i - begin)), line.formats[begin]});
+        begin = i;
+      }
+    }
+    return;
+  }
+
+  const Line& line = m_lines[size_t(index)];
+  m_scratch.resize(line.byteLen);
+  copyOut(line.bytePos, line.byteLen, m_scratch.data());
+  for (quint32 r = 0; r < line.runCount; ++r) {
+    const Run& run = m_runs[(line.runPos + r) % m_runs.size()];
+    const quint32 end = r + 1 < line.runCount ? m_runs[(line.runPos + r + 1) % m_runs.size()].offset : line.byteLen;
+    out.push_back({QString::fromUtf8(m_scratch.data() + run.offset, int(end - run.offset)), int(run.format)});
+  }
+}
+
+QByteArray ConsoleLog::lineUtf8(int index) const {
+  if (size_t(index) >= m_lines.size()) {
+    const TailLine& line = m_tail[size_t(index) - m_lines.size()];
+    return QString(reinterpret_cast<const QChar*>(line.chars.data()), int(line.chars.size())).toUtf8();
+  }
+  const Line& line = m_lines[size_t(index)];
+  QByteArray ret(int(line.byteLen), Qt::Uninitialized);
+  copyOut(line.bytePos, line.byteLen, ret.data());
+  return ret;
+}
+
+bool ConsoleLog::saveTo(QIODevice& out) {
+  if (m_droppedLines > 0) {
+    const QByteArray note = "[" + QByteArray::number(m_droppedLines) + " earlier lines were dropped]\n";
+    if (out.write(note) != note.size())
+      return false;
+  }
+  std::vector<char> buf;
+  for (QTemporaryFile* spill : {m_oldSpill.get(), m_spill.get()}) {
+    if (spill == nullptr)
+      continue;
+    buf.resize(SpillCopyBufSize);
+    const qint64 end = spill->pos();
+    bool ok = spill->seek(0);
+    for (qint64 n; ok && (n = spill->read(buf.data(), qint64(buf.size()))) > 0;)
+      ok = out.write(buf.data(), n) == n;
+    spill->seek(end);
+    if (!ok)
+      return false;
+  }
+
+  for (int i = 0; i < lineCount(); ++i) {
+    QByteArray line = lineUtf8(i);
+    if (i + 1 < lineCount())
+      line.append('\n');
+    if (out.write(line) != line.size())
+      return false;
+  }
+  return true;
+}
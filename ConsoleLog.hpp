@@ -0,0 +1,109 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <QString>
+#include <QTemporaryFile>
+
+#include "TerminalParser.hpp"
+
+/**
+ * Scrollback storage for the process console.
+ * Finished lines are kept as UTF-8 in a fixed-size byte ring, with one (offset, format) pair
+ * per run of equally formatted text in a second ring. The rings and the line index share the
+ * configured capacity; when any of them is full the oldest lines are evicted to an on-disk
+ * spill, so memory stays bounded however long a job runs while saveTo() can still reproduce
+ * the session. The spill is split over two files: once the current one reaches half the spill
+ * capacity it replaces the previous one, whose lines are dropped.
+ *
+ * The last TailLines lines form a small terminal grid held as UTF-16. Cursor-up, carriage
+ * returns and overwrites are applied there in memory, as a terminal would; a line is encoded
+ * into the ring only once it scrolls out of the grid, when it can no longer change.
+ */
+class ConsoleLog : public TerminalParser::Sink {
+public:
+  struct Span {
+    QString text;
+    int format;
+  };
+
+  static constexpr qint64 DefaultCapacity = 32 * 1024 * 1024;
+  static constexpr qint64 DefaultSpillCapacity = 1024 * 1024 * 1024;
+  static constexpr int TailLines = 128;
+
+  explicit ConsoleLog(qint64 capacityBytes = DefaultCapacity, qint64 spillBytes = DefaultSpillCapacity);
+
+  // Discards all content, including the spill; a spill capacity of 0 drops evicted lines at once
+  void setCapacity(qint64 capacityBytes, qint64 spillBytes = DefaultSpillCapacity);
+  void clear();
+
+  void text(const QChar* data, int len, int format) override;
+  void carriageReturn() override;
+  void lineFeed() override;
+  void cursorUp(int lines) override;
+  // Finalizes the whole grid and continues on a fresh line, e.g. when a process exits
+  void flushTail();
+
+  // Finished lines followed by the grid
+  int lineCount() const { return int(m_lines.size() + m_tail.size()); }
+  // Number of lines evicted so far; lineCount() indices are relative to this
+  qint64 firstLineNumber() const { return m_firstLineNumber; }
+  int maxColumns() const { return m_maxColumns; }
+
+  void lineSpans(int index, QVector<Span>& out) const;
+  QByteArray lineUtf8(int index) const;
+
+  bool saveTo(QIODevice& out);
+
+  // Heap bytes held by the rings, line index and grid; excludes the spill
+  qint64 memoryUsage() const;
+
+private:
+  struct Run {
+    quint32 offset; // bytes from the start of the line
+    quint32 format;
+  };
+  struct Line {
+    quint64 bytePos; // logical positions; the physical index is modulo the ring size
+    quint64 runPos;
+    quint32 byteLen;
+    quint32 runCount;
+  };
+
+  struct TailLine {
+    std::vector<char16_t> chars;
+    std::vector<int> formats; // one per UTF-16 unit
+  };
+
+  bool reserve(quint64 bytes, quint64 runs);
+  void evictFront();
+  bool writeSpill(const char* data, qint64 len);
+  void copyOut(quint64 pos, quint32 len, char* dst) const;
+  void commitLine(const TailLine& line);
+  void commitFrontTail();
+
+  std::vector<char> m_bytes;
+  std::vector<Run> m_runs;
+  std::deque<Line> m_lines;
+  size_t m_maxLines = 0;
+  quint64 m_byteTail = 0;
+  quint64 m_runTail = 0;
+  qint64 m_firstLineNumber = 0;
+  int m_maxColumns = 0;
+
+  // Lines still open to cursor movement; never empty
+  std::deque<TailLine> m_tail;
+  size_t m_row = 0;
+  size_t m_column = 0;
+
+  std::unique_ptr<QTemporaryFile> m_spill;
+  std::unique_ptr<QTemporaryFile> m_oldSpill;
+  qint64 m_spillCapacity = 0;
+  qint64 m_spillLines = 0;
+  qint64 m_oldSpillLines = 0;
+  qint64 m_droppedLines = 0; // evicted and no longer in either spill file
+  bool m_spillFailed = false;
+  mutable std::vector<char> m_scratch;
+};
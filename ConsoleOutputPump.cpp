@@ -0,0 +1,239 @@
+#include "ConsoleOutputPump.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include <QIODevice>
+
+#include "Utf8StreamDecoder.hpp"
+
+namespace {
+constexpr int DefaultIntervalMsec = 16;
+constexpr qint64 DefaultMaxBytesPerFlush = 256 * 1024;
+constexpr size_t InputRingSize = 1024 * 1024;
+constexpr size_t OutputRingSize = 4 * 1024 * 1024;
+constexpr size_t WorkerChunkSize = 64 * 1024;
+// Keeps every text record well below the output ring size
+constexpr int MaxTextUnits = 16 * 1024;
+
+enum class EventType : quint32 { Text, CarriageReturn, LineFeed, CursorUp, DefineFormat };
+
+struct EventHeader {
+  EventType type;
+  quint32 arg; // unit count for text, line count for cursor-up, index for format definitions
+  qint32 format;
+};
+} // namespace
+
+/* Serializes parser output into the output ring; runs on the worker thread */
+class ConsoleOutputPump::EventWriter : public TerminalParser::Sink {
+  ConsoleOutputPump& m_pump;
+  const TerminalParser& m_parser;
+  int m_defined = 0;
+
+  void put(const EventHeader& header, const void* payload = nullptr, size_t payloadLen = 0) {
+    // Waits for the GUI to catch up rather than dropping output
+    while (!m_pump.m_output.tryWrite(&header, sizeof(header), payload, payloadLen)) {
+      if (m_pump.m_stop.load(std::memory_order_relaxed))
+        return;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+public:
+  EventWriter(ConsoleOutputPump& pump, const TerminalParser& parser) : m_pump(pump), m_parser(parser) {}
+
+  void text(const QChar* data, int len, int format) override {
+    for (const TermFormatTable& formats = m_parser.formats(); m_defined < formats.size(); ++m_defined) {
+      const TermFormat state = formats.state(m_defined);
+      put({EventType::DefineFormat, quint32(m_defined), 0}, &state, sizeof(state));
+    }
+    for (int offset = 0; offset < len; offset += MaxTextUnits) {
+      const int units = std::min(len - offset, MaxTextUnits);
+      put({EventType::Text, quint32(units), format}, data + offset, size_t(units) * sizeof(QChar));
+    }
+  }
+  void carriageReturn() override { put({EventType::CarriageReturn, 0, 0}); }
+  void lineFeed() override { put({EventType::LineFeed, 0, 0}); }
+  void cursorUp(int lines) override { put({EventType::CursorUp, quint32(lines), 0}); }
+};
+
+ConsoleOutputPump::ConsoleOutputPump(QObject* parent)
+: QObject(parent)
+, m_timer(this)
+, m_maxBytesPerFlush(DefaultMaxBytesPerFlush)
+, m_readBuf(InputRingSize)
+, m_input(InputRingSize)
+, m_output(OutputRingSize) {
+  m_timer.setSingleShot(true);
+  m_timer.setInterval(DefaultIntervalMsec);
+  connect(&m_timer, &QTimer::timeout, this, &ConsoleOutputPump::tick);
+  startWorker();
+}
+
+ConsoleOutputPump::~ConsoleOutputPump() { stopWorker(); }
+
+void ConsoleOutputPump::startWorker() {
+  m_stop.store(false);
+  m_worker = std::thread(&ConsoleOutputPump::workerMain, this);
+}
+
+void ConsoleOutputPump::stopWorker() {
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_stop.store(true);
+  }
+  m_wake.notify_one();
+  if (m_worker.joinable())
+    m_worker.join();
+}
+
+void ConsoleOutputPump::workerMain() {
+  Utf8StreamDecoder decoder;
+  TerminalParser parser;
+  EventWriter writer(*this, parser);
+  std::vector<char> chunk(WorkerChunkSize);
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_wakeMutex);
+      m_wake.wait(lock, [this] { return m_stop.load() || m_input.readAvailable() > 0; });
+    }
+    if (m_stop.load())
+      return;
+
+    const size_t len = std::min(m_input.readAvailable(), chunk.size());
+    m_input.read(chunk.data(), len);
+    int textLen = 0;
+    const QChar* text = decoder.decode(chunk.data(), qint64(len), &textLen);
+    parser.feed(text, textLen, writer);
+    // Published after the events, so the GUI never sees these bytes done with output missing
+    m_processed.fetch_add(len, std::memory_order_release);
+  }
+}
+
+void ConsoleOutputPump::append(const QByteArray& data) {
+  if (data.isEmpty())
+    return;
+  if (m_inputTap)
+    m_inputTap(data.constData(), data.size());
+  m_backlog.append(data);
+  pushInput();
+  // The first bytes after an idle period arm the timer; later ones ride along
+  if (!m_timer.isActive())
+    m_timer.start();
+}
+
+void ConsoleOutputPump::appendFrom(QIODevice& device) {
+  m_source = &device;
+  pushInput();
+  if (!m_timer.isActive())
+    m_timer.start();
+}
+
+void ConsoleOutputPump::pushInput() {
+  size_t pushed = 0;
+  if (!m_backlog.isEmpty()) {
+    const size_t n = m_input.writeSome(m_backlog.constData(), size_t(m_backlog.size()));
+    m_backlog.remove(0, int(n));
+    pushed += n;
+  }
+  if (m_backlog.isEmpty() && m_source) {
+    const qint64 room = qint64(std::min(m_input.writeAvailable(), m_readBuf.size()));
+    const qint64 n = room > 0 ? m_source->read(m_readBuf.data(), std::min(room, m_source->bytesAvailable())) : 0;
+    if (n > 0) {
+      if (m_inputTap)
+        m_inputTap(m_readBuf.data(), n);
+      pushed += m_input.writeSome(m_readBuf.data(), size_t(n));
+    }
+  }
+  if (pushed > 0) {
+    m_submitted += pushed;
+    {
+      std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wake.notify_one();
+  }
+}
+
+bool ConsoleOutputPump::deliver(qint64 budget) {
+  bool delivered = false;
+  EventHeader header;
+  for (qint64 used = 0; used < budget && m_output.readAvailable() >= sizeof(header);) {
+    m_output.read(&header, sizeof(header));
+    used += qint64(sizeof(header));
+    delivered = true;
+    switch (header.type) {
+    case EventType::Text:
+      m_text.resize(header.arg);
+      m_output.read(m_text.data(), header.arg * sizeof(char16_t));
+      used += qint64(header.arg * sizeof(char16_t));
+      if (m_sink)
+        m_sink->text(reinterpret_cast<const QChar*>(m_text.data()), int(header.arg),
+                     m_formatMap[size_t(header.format)]);
+      break;
+    case EventType::CarriageReturn:
+      if (m_sink)
+        m_sink->carriageReturn();
+      break;
+    case EventType::LineFeed:
+      if (m_sink)
+        m_sink->lineFeed();
+      break;
+    case EventType::CursorUp:
+      if (m_sink)
+        m_sink->cursorUp(int(header.arg));
+      break;
+    case EventType::DefineFormat: {
+      TermFormat state;
+      m_output.read(&state, sizeof(state));
+      if (m_formatMap.size() <= header.arg)
+        m_formatMap.resize(header.arg + 1);
+      m_formatMap[header.arg] = m_formats.intern(state);
+      break;
+    }
+    }
+  }
+  return delivered;
+}
+
+bool ConsoleOutputPump::idle() const {
+  return m_backlog.isEmpty() && (!m_source || m_source->bytesAvailable() <= 0) &&
+         m_processed.load(std::memory_order_acquire) == m_submitted && m_output.readAvailable() == 0;
+}
+
+void ConsoleOutputPump::tick() {
+  pushInput();
+  if (deliver(m_maxBytesPerFlush) && m_flushHandler)
+    m_flushHandler();
+  // Keep ticking while the worker still has output in flight
+  if (!idle())
+    m_timer.start();
+}
+
+void ConsoleOutputPump::drain() {
+  m_timer.stop();
+  bool delivered = false;
+  for (;;) {
+    pushInput();
+    delivered |= deliver(std::numeric_limits<qint64>::max());
+    if (idle())
+      break;
+    std::this_thread::yield();
+  }
+  if (delivered && m_flushHandler)
+    m_flushHandler();
+}
+
+void ConsoleOutputPump::clear() {
+  m_timer.stop();
+  stopWorker();
+  m_input.reset();
+  m_output.reset();
+  m_backlog.clear();
+  m_source = nullptr;
+  m_submitted = 0;
+  m_processed.store(0);
+  m_formatMap.clear();
+  startWorker();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QByteArray>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+#include "SpscRing.hpp"
+#include "TerminalParser.hpp"
+
+class QIODevice;
+
+/**
+ * Moves process output from the device to the console off the GUI thread.
+ * Raw bytes go through a lock-free ring to a worker thread, which decodes UTF-8 and runs the
+ * terminal parser. The parsed text runs and control events come back through a second ring.
+ * The GUI thread picks them up at most once per display frame, capped per flush so a burst
+ * can't stall repaints, and only inserts them into the sink.
+ * The worker's format indices are translated into formats(), which belongs to the GUI thread.
+ */
+class ConsoleOutputPump : public QObject {
+  Q_OBJECT
+
+public:
+  explicit ConsoleOutputPump(QObject* parent = Q_NULLPTR);
+  ~ConsoleOutputPump() override;
+
+  void setSink(TerminalParser::Sink* sink) { m_sink = sink; }
+  // Runs after each batch of events has been delivered to the sink
+  void setFlushHandler(std::function<void()>&& handler) { m_flushHandler = std::move(handler); }
+  // Sees every raw byte as it is accepted, before decoding
+  void setInputTap(std::function<void(const char*, qint64)>&& tap) { m_inputTap = std::move(tap); }
+  void setInterval(int msec) { m_timer.setInterval(msec); }
+  void setMaxBytesPerFlush(qint64 bytes) { m_maxBytesPerFlush = bytes; }
+
+  TermFormatTable& formats() { return m_formats; }
+  const TermFormatTable& formats() const { return m_formats; }
+
+  void append(const QByteArray& data);
+  // Reads from the device as the input ring has room; the rest is picked up on later ticks
+  void appendFrom(QIODevice& device);
+  // Delivers everything still pending, e.g. before the process' exit is reported
+  void drain();
+  // Discards pending output and restarts parsing from a clean state
+  void clear();
+
+private:
+  class EventWriter;
+
+  void startWorker();
+  void stopWorker();
+  void workerMain();
+
+  void pushInput();
+  bool deliver(qint64 budget);
+  void tick();
+  bool idle() const;
+
+  TerminalParser::Sink* m_sink = nullptr;
+  std::function<void()> m_flushHandler;
+  std::function<void(const char*, qint64)> m_inputTap;
+  QTimer m_timer;
+  qint64 m_maxBytesPerFlush;
+
+  // GUI thread only
+  QPointer<QIODevice> m_source;
+  QByteArray m_backlog;
+  std::vector<char> m_readBuf;
+  quint64 m_submitted = 0;
+  TermFormatTable m_formats;
+  std::vector<int> m_formatMap; // worker format index -> m_formats index
+  std::vector<char16_t> m_text;
+
+  // Shared with the worker
+  SpscRing m_input;
+  SpscRing m_output;
+  std::atomic<quint64> m_processed{0};
+  std::atomic<bool> m_stop{false};
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+  std::thread m_worker;
+};
@@ -0,0 +1,63 @@
+#include "ConsoleProgress.hpp"
+
+namespace {
+// Shorter intervals make the rate estimate jump with every redraw
+constexpr qint64 RateSampleMsec = 250;
+constexpr double RateSmoothing = 0.3;
+} // namespace
+
+ConsoleProgressModel::ConsoleProgressModel(QObject* parent) : QObject(parent) { m_clock.start(); }
+
+void ConsoleProgressModel::update(const QString& label, int percent, qint64 done, qint64 total, double barFill) {
+  // hecl labels read "Phase... item"
+  const int split = label.indexOf(QStringLiteral("..."));
+  const QString phase = split >= 0 ? label.left(split).trimmed() : label;
+  const QString item = split >= 0 ? label.mid(split + 3).trimmed() : QString();
+
+  double fraction = barFill;
+  if (total > 0)
+    fraction = double(done) / double(total);
+  else if (percent >= 0)
+    fraction = percent / 100.0;
+
+  // Rates are only comparable between updates of the same counter or the same item
+  const QString rateKey = total > 0 ? phase : label;
+  const qint64 now = m_clock.elapsed();
+  if (rateKey != m_rateKey || fraction < m_sampleFraction) {
+    m_rateKey = rateKey;
+    m_rate = 0.0;
+    m_sampleMsec = now;
+    m_sampleFraction = fraction;
+  } else if (now - m_sampleMsec >= RateSampleMsec) {
+    const double rate = (fraction - m_sampleFraction) * 1000.0 / double(now - m_sampleMsec);
+    m_rate = m_rate > 0.0 ? m_rate + RateSmoothing * (rate - m_rate) : rate;
+    m_sampleMsec = now;
+    m_sampleFraction = fraction;
+  }
+
+  m_progress.active = true;
+  m_progress.phase = phase;
+  m_progress.item = item;
+  m_progress.done = done;
+  m_progress.total = total;
+  m_progress.fraction = fraction;
+  m_progress.throughput = m_rate * (total > 0 ? double(total) : 100.0);
+  m_progress.etaMsec = m_rate > 0.0 && fraction >= 0.0 ? qint64((1.0 - fraction) / m_rate * 1000.0) : -1;
+  m_dirty = true;
+}
+
+void ConsoleProgressModel::publish() {
+  if (!m_dirty)
+    return;
+  m_dirty = false;
+  emit changed(m_progress);
+}
+
+void ConsoleProgressModel::reset() {
+  m_progress = ConsoleProgress{};
+  m_rateKey.clear();
+  m_rate = 0.0;
+  m_sampleFraction = 0.0;
+  m_dirty = true;
+  publish();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+
+/* Progress of the running hecl job as recognized from its console output */
+struct ConsoleProgress {
+  bool active = false;
+  QString phase;      // e.g. "Extracting"
+  QString item;       // resource currently being worked on, if reported
+  qint64 done = -1;   // counters, when the line has "done/total"
+  qint64 total = -1;
+  double fraction = -1.0; // 0..1, negative while indeterminate
+  double throughput = 0.0; // items per second if total is known, otherwise percent per second
+  qint64 etaMsec = -1;
+};
+
+/**
+ * Accumulates progress updates and derives throughput and ETA from them.
+ * Updates arrive once per recognized line; changed() is only emitted from publish() so the
+ * widget is refreshed once per console flush at most.
+ */
+class ConsoleProgressModel : public QObject {
+  Q_OBJECT
+
+public:
+  explicit ConsoleProgressModel(QObject* parent = Q_NULLPTR);
+
+  // percent, done and total are negative when the line doesn't report them
+  void update(const QString& label, int percent, qint64 done, qint64 total, double barFill);
+  void publish();
+  void reset();
+
+  const ConsoleProgress& progress() const { return m_progress; }
+
+signals:
+  void changed(const ConsoleProgress& progress);
+
+private:
+  ConsoleProgress m_progress;
+  QString m_rateKey;
+  QElapsedTimer m_clock;
+  qint64 m_sampleMsec = 0;
+  double m_sampleFraction = 0.0;
+  double m_rate = 0.0; // fraction per second
+  bool m_dirty = false;
+};
@@ -0,0 +1,56 @@
+#include "ConsoleProgressWidget.hpp"
+
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QProgressBar>
+
+namespace {
+QString FormatDuration(qint64 msec) {
+  const qint64 secs = (msec + 999) / 1000;
+  if (secs >= 3600)
+    return QStringLiteral("%1:%2:%3")
+        .arg(secs / 3600)
+        .arg(secs / 60 % 60, 2, 10, QLatin1Char{'0'})
+        .arg(secs % 60, 2, 10, QLatin1Char{'0'});
+  return QStringLiteral("%1:%2").arg(secs / 60).arg(secs % 60, 2, 10, QLatin1Char{'0'});
+}
+} // namespace
+
+ConsoleProgressWidget::ConsoleProgressWidget(QWidget* parent)
+: QWidget(parent), m_bar(new QProgressBar(this)), m_label(new QLabel(this)) {
+  auto* layout = new QHBoxLayout(this);
+  layout->setContentsMargins(0, 0, 0, 0);
+  layout->addWidget(m_bar, 1);
+  layout->addWidget(m_label, 2);
+  m_bar->setRange(0, 1000);
+  m_bar->setTextVisible(true);
+  m_label->setTextFormat(Qt::PlainText);
+  hide();
+}
+
+void ConsoleProgressWidget::setProgress(const ConsoleProgress& progress) {
+  setVisible(progress.active);
+  if (!progress.active)
+    return;
+
+  if (progress.fraction < 0.0) {
+    m_bar->setRange(0, 0);
+  } else {
+    m_bar->setRange(0, 1000);
+    m_bar->setValue(int(progress.fraction * 1000.0));
+  }
+  m_bar->setFormat(progress.total > 0 ? QStringLiteral("%1/%2").arg(progress.done).arg(progress.total)
+                                      : QStringLiteral("%p%"));
+
+  QString text = progress.phase;
+  if (!progress.item.isEmpty())
+    text += QStringLiteral(": ") + progress.item;
+  if (progress.throughput > 0.0) {
+    text += QStringLiteral(" - ") +
+            (progress.total > 0 ? tr("%1 items/s").arg(progress.throughput, 0, 'f', 1)
+                                : tr("%1%/s").arg(progress.throughput, 0, 'f', 1));
+  }
+  if (progress.etaMsec >= 0)
+    text += QStringLiteral(" - ") + tr("ETA %1").arg(FormatDuration(progress.etaMsec));
+  m_label->setText(text);
+}
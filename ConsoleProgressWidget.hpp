@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QWidget>
+
+#include "ConsoleProgress.hpp"
+
+class QLabel;
+class QProgressBar;
+
+/* Progress bar with phase, throughput and ETA for the running hecl job; hidden while idle */
+class ConsoleProgressWidget : public QWidget {
+  Q_OBJECT
+
+public:
+  explicit ConsoleProgressWidget(QWidget* parent = Q_NULLPTR);
+
+public slots:
+  void setProgress(const ConsoleProgress& progress);
+
+private:
+  QProgressBar* m_bar;
+  QLabel* m_label;
+};
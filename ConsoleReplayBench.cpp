@@ -0,0 +1,293 @@
+/*
+ * Replays captured hecl/urde output through the console pipeline and reports its cost.
+ *
+ *   QT_QPA_PLATFORM=offscreen hecl-gui-console-bench [--chunks 512,4096,65536] [--repeat N]
+ *                                                    [--render] [--threaded] [capture.log...]
+ *
+ * Captures are the raw process bytes, escape sequences included, e.g. from
+ * `TERM=xterm-color hecl package MP1 -y -g > capture.log`.
+ * The default mode runs decoding, parsing, progress recognition and log insertion on the
+ * calling thread so the numbers don't depend on scheduling; --threaded goes through
+ * ConsoleOutputPump instead, and --render paints the view after every chunk.
+ * Before timing anything, a few built-in replay cases check what reaches the log, e.g. that
+ * CRLF-terminated lines survive progress recognition and that a shorter redraw after cursor-up
+ * leaves nothing of the previous one; a failing case exits with status 1.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+#include "ConsoleLog.hpp"
+#include "ConsoleOutputPump.hpp"
+#include "ConsoleProgress.hpp"
+#include "ConsoleView.hpp"
+#include "ProgressRecognizer.hpp"
+#include "TerminalParser.hpp"
+#include "Utf8StreamDecoder.hpp"
+
+#if !_WIN32
+#include <sys/resource.h>
+#endif
+
+static std::atomic<quint64> AllocationCount{0};
+
+#if defined(__GLIBC__)
+// Qt containers allocate with malloc, so count at that level where glibc allows interposing it
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+  AllocationCount.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+void* calloc(size_t n, size_t size) {
+  AllocationCount.fetch_add(1, std::memory_order_relaxed);
+  return __libc_calloc(n, size);
+}
+void* realloc(void* ptr, size_t size) {
+  AllocationCount.fetch_add(1, std::memory_order_relaxed);
+  return __libc_realloc(ptr, size);
+}
+}
+#else
+void* operator new(size_t size) {
+  AllocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+#endif
+
+namespace {
+struct Options {
+  QList<int> chunkSizes{512, 4096, 65536};
+  int repeat = 3;
+  bool render = false;
+  bool threaded = false;
+  QStringList files;
+};
+
+struct Result {
+  qint64 bytes = 0;
+  qint64 nsecs = 0;
+  quint64 allocations = 0;
+  qint64 peakLogMemory = 0;
+};
+
+qint64 PeakRssKiB() {
+#if !_WIN32
+  rusage usage = {};
+  getrusage(RUSAGE_SELF, &usage);
+#if __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#else
+  return -1;
+#endif
+}
+
+Result Replay(const QByteArray& data, int chunkSize, const Options& options) {
+  ConsoleView view;
+  view.resize(1100, 700);
+  if (options.render)
+    view.show();
+  ConsoleProgressModel progressModel;
+  ProgressRecognizer progressFilter(progressModel);
+  progressFilter.setDownstream(&view.log());
+
+  const int size = int(data.size());
+  Result result;
+  QElapsedTimer timer;
+  const auto finishChunk = [&] {
+    progressFilter.flushPending();
+    progressModel.publish();
+    if (options.render) {
+      view.contentsChanged();
+      view.viewport()->repaint();
+    }
+    result.peakLogMemory = std::max(result.peakLogMemory, view.log().memoryUsage());
+  };
+
+  if (options.threaded) {
+    ConsoleOutputPump pump;
+    pump.setSink(&progressFilter);
+    pump.setFlushHandler(std::function<void()>(finishChunk));
+    view.setFormats(&pump.formats());
+    const quint64 allocationsBefore = AllocationCount.load();
+    timer.start();
+    for (int offset = 0; offset < size; offset += chunkSize) {
+      pump.append(QByteArray::fromRawData(data.constData() + offset, std::min(chunkSize, size - offset)));
+      QCoreApplication::processEvents();
+    }
+    pump.drain();
+    progressFilter.finish();
+    view.log().flushTail();
+    result.nsecs = timer.nsecsElapsed();
+    result.allocations = AllocationCount.load() - allocationsBefore;
+  } else {
+    Utf8StreamDecoder decoder;
+    TerminalParser parser;
+    view.setFormats(&parser.formats());
+    const quint64 allocationsBefore = AllocationCount.load();
+    timer.start();
+    for (int offset = 0; offset < size; offset += chunkSize) {
+      int textLen = 0;
+      const QChar* text =
+          decoder.decode(data.constData() + offset, std::min(chunkSize, size - offset), &textLen);
+      parser.feed(text, textLen, progressFilter);
+      finishChunk();
+    }
+    progressFilter.finish();
+    view.log().flushTail();
+    result.nsecs = timer.nsecsElapsed();
+    result.allocations = AllocationCount.load() - allocationsBefore;
+  }
+  result.peakLogMemory = std::max(result.peakLogMemory, view.log().memoryUsage());
+  result.bytes = size;
+  return result;
+}
+
+// Everything a replay case left in the log, without the fresh line flushTail() continues on
+QStringList LogLines(ConsoleLog& log) {
+  log.flushTail();
+  QStringList lines;
+  for (int i = 0; i + 1 < log.lineCount(); ++i)
+    lines.push_back(QString::fromUtf8(log.lineUtf8(i)));
+  return lines;
+}
+
+struct ReplayCase {
+  const char* name;
+  const char* input;
+  QStringList expected;
+};
+
+bool RunReplayCases() {
+  const ReplayCase cases[] = {
+      {"crlf-percent", "Cooking foo 50%\r\nCooking bar 100%\r\n",
+       {QStringLiteral("Cooking foo 50%"), QStringLiteral("Cooking bar 100%")}},
+      {"cr-redraw", "Packaging  10%\rPackaging  60%\rPackaging 100%\r\ndone\r\n",
+       {QStringLiteral("Packaging 100%"), QStringLiteral("done")}},
+      {"lf-bar", "[##------]\rdone\n", {QStringLiteral("done")}},
+      {"cursor-up-redraw", "Cooking MP1 worlds\nCooking Metroid1 area 12\n\x1b[2AMP1 done\nArea 3\n",
+       {QStringLiteral("MP1 done"), QStringLiteral("Area 3")}},
+  };
+
+  bool ok = true;
+  for (const ReplayCase& replayCase : cases) {
+    const QByteArray data(replayCase.input);
+    // Whole, and one byte at a time so a CR and its LF arrive in separate chunks
+    for (int chunkSize : {int(data.size()), 1}) {
+      ConsoleProgressModel progressModel;
+      ProgressRecognizer progressFilter(progressModel);
+      ConsoleLog log(0); // the minimum capacity is plenty for a few lines
+      progressFilter.setDownstream(&log);
+      Utf8StreamDecoder decoder;
+      TerminalParser parser;
+      for (int offset = 0; offset < data.size(); offset += chunkSize) {
+        int textLen = 0;
+        const QChar* text = decoder.decode(data.constData() + offset, std::min(chunkSize, int(data.size()) - offset),
+                                           &textLen);
+        parser.feed(text, textLen, progressFilter);
+        progressFilter.flushPending();
+      }
+      progressFilter.finish();
+
+      const QStringList lines = LogLines(log);
+      if (lines != replayCase.expected) {
+        ok = false;
+        std::fprintf(stderr, "replay case %s (chunk %d) failed:\n  expected: %s\n  got:      %s\n",
+                     replayCase.name, chunkSize, qUtf8Printable(replayCase.expected.join(QStringLiteral(" | "))),
+                     qUtf8Printable(lines.join(QStringLiteral(" | "))));
+      }
+    }
+  }
+  return ok;
+}
+
+bool ParseArgs(const QStringList& args, Options& options) {
+  for (int i = 1; i < args.size(); ++i) {
+    const QString& arg = args[i];
+    if (arg == QStringLiteral("--chunks") && i + 1 < args.size()) {
+      options.chunkSizes.clear();
+      for (const QString& size : args[++i].split(QLatin1Char{','})) {
+        const int value = size.toInt();
+        if (value <= 0)
+          return false;
+        options.chunkSizes.push_back(value);
+      }
+    } else if (arg == QStringLiteral("--repeat") && i + 1 < args.size()) {
+      options.repeat = std::max(1, args[++i].toInt());
+    } else if (arg == QStringLiteral("--render")) {
+      options.render = true;
+    } else if (arg == QStringLiteral("--threaded")) {
+      options.threaded = true;
+    } else if (arg.startsWith(QStringLiteral("--"))) {
+      return false;
+    } else {
+      options.files.push_back(arg);
+    }
+  }
+  return true;
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  QApplication app(argc, argv);
+
+  Options options;
+  if (!ParseArgs(QCoreApplication::arguments(), options)) {
+    std::fprintf(stderr, "usage: %s [--chunks 512,4096,...] [--repeat N] [--render] [--threaded] [capture...]\n",
+                 argv[0]);
+    return 2;
+  }
+
+  if (!RunReplayCases())
+    return 1;
+  std::printf("replay cases passed\n");
+  if (options.files.isEmpty())
+    return 0;
+
+  std::printf("%-32s %8s %10s %12s %12s\n", "file", "chunk", "MB/s", "allocs/MB", "log KiB");
+  for (const QString& path : options.files) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+      std::fprintf(stderr, "unable to read %s\n", qUtf8Printable(path));
+      return 1;
+    }
+    const QByteArray data = file.readAll();
+    const double megabytes = std::max<qint64>(data.size(), 1) / (1024.0 * 1024.0);
+
+    for (int chunkSize : options.chunkSizes) {
+      // Best of N; the first run also warms up fonts and the format table
+      Result best;
+      for (int i = 0; i < options.repeat; ++i) {
+        const Result result = Replay(data, chunkSize, options);
+        if (best.nsecs == 0 || result.nsecs < best.nsecs)
+          best = result;
+      }
+      const double seconds = std::max<qint64>(best.nsecs, 1) / 1e9;
+      std::printf("%-32s %8d %10.1f %12.1f %12lld\n", qUtf8Printable(QFileInfo(path).fileName()), chunkSize,
+                  megabytes / seconds, best.allocations / megabytes, static_cast<long long>(best.peakLogMemory / 1024));
+    }
+  }
+  std::printf("peak RSS: %lld KiB\n", static_cast<long long>(PeakRssKiB()));
+  return 0;
+}
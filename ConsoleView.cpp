@@ -0,0 +1,266 @@
+#include "ConsoleView.hpp"
+
+#include <algorithm>
+#include <climits>
+
+#include <QAction>
+#include <QApplication>
+#include <QClipboard>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+
+#include "TermFormatTable.hpp"
+
+ConsoleView::ConsoleView(QWidget* parent) : QAbstractScrollArea(parent) {
+  setFocusPolicy(Qt::StrongFocus);
+  viewport()->setCursor(Qt::IBeamCursor);
+
+  auto* copyAction = new QAction(tr("&Copy"), this);
+  copyAction->setShortcut(QKeySequence::Copy);
+  copyAction->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+  connect(copyAction, &QAction::triggered, this, &ConsoleView::copy);
+  addAction(copyAction);
+  setContextMenuPolicy(Qt::ActionsContextMenu);
+
+  updateScrollBars();
+}
+
+void ConsoleView::setFormats(const TermFormatTable* formats) {
+  m_formats = formats;
+  m_fonts.clear();
+  viewport()->update();
+}
+
+void ConsoleView::clear() {
+  m_log.clear();
+  m_firstLineNumber = 0;
+  m_widestLine = 0;
+  m_selAnchor = m_selEnd = TextPos();
+  contentsChanged();
+}
+
+void ConsoleView::contentsChanged() {
+  QScrollBar* vbar = verticalScrollBar();
+  const bool following = vbar->value() == vbar->maximum();
+  // Keep the same text in view when old lines are evicted underneath it
+  const qint64 evicted = m_log.firstLineNumber() - m_firstLineNumber;
+  m_firstLineNumber = m_log.firstLineNumber();
+  const int oldValue = vbar->value();
+  updateScrollBars();
+  vbar->setValue(following ? vbar->maximum() : int(std::max<qint64>(oldValue - evicted, 0)));
+  viewport()->update();
+}
+
+int ConsoleView::visibleLines() const {
+  return std::max(1, viewport()->height() / std::max(1, fontMetrics().lineSpacing()));
+}
+
+void ConsoleView::updateScrollBars() {
+  const int pageLines = visibleLines();
+  QScrollBar* vbar = verticalScrollBar();
+  vbar->setRange(0, std::max(0, m_log.lineCount() - pageLines));
+  vbar->setPageStep(pageLines);
+  vbar->setSingleStep(1);
+
+  const int charWidth = fontMetrics().horizontalAdvance(QLatin1Char{'M'});
+  QScrollBar* hbar = horizontalScrollBar();
+  const int contentWidth = std::max(m_log.maxColumns() * charWidth, m_widestLine);
+  hbar->setRange(0, std::max(0, contentWidth - viewport()->width()));
+  hbar->setPageStep(viewport()->width());
+  hbar->setSingleStep(charWidth);
+}
+
+const ConsoleView::SpanFont& ConsoleView::fontFor(int format) {
+  while (int(m_fonts.size()) <= format) {
+    const int index = int(m_fonts.size());
+    const QFont spanFont =
+        m_formats && index < m_formats->size() ? m_formats->format(index).font().resolve(font()) : font();
+    m_fonts.push_back({spanFont, QFontMetrics(spanFont)});
+  }
+  return m_fonts[size_t(format)];
+}
+
+/* Fetches a line into m_spans with tabs expanded, and returns its width. With boundaries, also
+ * records the x offset of every boundary between source UTF-16 units, n + 1 entries in all. */
+int ConsoleView::layoutLine(int line, std::vector<int>* boundaries) {
+  m_log.lineSpans(line, m_spans);
+  if (boundaries) {
+    boundaries->clear();
+    boundaries->push_back(0);
+  }
+  int column = 0;
+  int x = 0;
+  for (ConsoleLog::Span& span : m_spans) {
+    const SpanFont& spanFont = fontFor(span.format);
+    if (!boundaries && !span.text.contains(QLatin1Char{'\t'})) {
+      column += span.text.size();
+      x += spanFont.metrics.horizontalAdvance(span.text);
+      continue;
+    }
+    QString expanded;
+    expanded.reserve(span.text.size());
+    const int spaceWidth = spanFont.metrics.horizontalAdvance(QLatin1Char{' '});
+    for (const QChar c : span.text) {
+      if (c == QLatin1Char{'\t'}) {
+        const int spaces = TabWidth - column % TabWidth;
+        expanded.append(QString(spaces, QLatin1Char{' '}));
+        column += spaces;
+        x += spaces * spaceWidth;
+      } else {
+        expanded.append(c);
+        ++column;
+        x += spanFont.metrics.horizontalAdvance(c);
+      }
+      if (boundaries)
+        boundaries->push_back(x);
+    }
+    span.text = std::move(expanded);
+  }
+  return x;
+}
+
+void ConsoleView::paintEvent(QPaintEvent*) {
+  QPainter painter(viewport());
+  const QFontMetrics fm = fontMetrics();
+  const int lineHeight = fm.lineSpacing();
+  const int firstLine = verticalScrollBar()->value();
+  const int lastLine = std::min(m_log.lineCount(), firstLine + visibleLines() + 1);
+  const int x0 = -horizontalScrollBar()->value();
+  const bool hasSelection = m_selAnchor.line >= 0 && (m_selAnchor < m_selEnd || m_selEnd < m_selAnchor);
+  const TextPos selBegin = std::min(m_selAnchor, m_selEnd);
+  const TextPos selEnd = std::max(m_selAnchor, m_selEnd);
+  const QColor defaultText = palette().color(QPalette::Text);
+  const int newlineWidth = fm.horizontalAdvance(QLatin1Char{' '});
+  int widest = m_widestLine;
+
+  int y = 0;
+  for (int line = firstLine; line < lastLine; ++line, y += lineHeight) {
+    const qint64 lineNumber = m_firstLineNumber + line;
+    const bool selected = hasSelection && lineNumber >= selBegin.line && lineNumber <= selEnd.line;
+    const int lineWidth = layoutLine(line, selected ? &m_boundaries : nullptr);
+    widest = std::max(widest, lineWidth);
+    if (selected) {
+      const int last = int(m_boundaries.size()) - 1;
+      const int from = lineNumber == selBegin.line ? m_boundaries[size_t(std::min(selBegin.column, last))] : 0;
+      // A selection continuing past this line includes its newline, shown as one space
+      const int to = lineNumber == selEnd.line ? m_boundaries[size_t(std::min(selEnd.column, last))]
+                                               : lineWidth + newlineWidth;
+      painter.fillRect(x0 + from, y, to - from, lineHeight, palette().color(QPalette::Highlight));
+    }
+
+    int x = x0;
+    for (const ConsoleLog::Span& span : m_spans) {
+      const SpanFont& spanFont = fontFor(span.format);
+      const int width = spanFont.metrics.horizontalAdvance(span.text);
+      if (x + width > 0) {
+        const QTextCharFormat* format =
+            m_formats && span.format < m_formats->size() ? &m_formats->format(span.format) : nullptr;
+        if (format && format->background().style() != Qt::NoBrush)
+          painter.fillRect(x, y, width, lineHeight, format->background());
+        painter.setFont(spanFont.font);
+        painter.setPen(format && format->foreground().style() != Qt::NoBrush ? format->foreground().color()
+                                                                              : defaultText);
+        painter.drawText(x, y + fm.ascent(), span.text);
+      }
+      x += width;
+      if (x >= viewport()->width())
+        break;
+    }
+  }
+
+  if (widest > m_widestLine) {
+    m_widestLine = widest;
+    updateScrollBars();
+  }
+}
+
+void ConsoleView::resizeEvent(QResizeEvent* e) {
+  QAbstractScrollArea::resizeEvent(e);
+  contentsChanged();
+}
+
+void ConsoleView::changeEvent(QEvent* e) {
+  if (e->type() == QEvent::FontChange) {
+    m_fonts.clear();
+    contentsChanged();
+  }
+  QAbstractScrollArea::changeEvent(e);
+}
+
+qint64 ConsoleView::lineAt(int y) const {
+  const int line = verticalScrollBar()->value() + y / std::max(1, fontMetrics().lineSpacing());
+  return m_firstLineNumber + std::clamp(line, 0, m_log.lineCount() - 1);
+}
+
+ConsoleView::TextPos ConsoleView::posAt(const QPoint& pos) {
+  TextPos result;
+  if (m_log.lineCount() == 0)
+    return result;
+  result.line = lineAt(pos.y());
+  layoutLine(int(result.line - m_firstLineNumber), &m_boundaries);
+  // The nearest boundary between characters, as in a text editor
+  const int x = pos.x() + horizontalScrollBar()->value();
+  int column = 0;
+  while (column + 1 < int(m_boundaries.size()) &&
+         x > (m_boundaries[size_t(column)] + m_boundaries[size_t(column) + 1]) / 2)
+    ++column;
+  result.column = column;
+  return result;
+}
+
+void ConsoleView::mousePressEvent(QMouseEvent* e) {
+  if (e->button() == Qt::LeftButton) {
+    const TextPos pos = posAt(e->pos());
+    if (!(e->modifiers() & Qt::ShiftModifier) || m_selAnchor.line < 0)
+      m_selAnchor = pos;
+    m_selEnd = pos;
+    viewport()->update();
+  }
+  QAbstractScrollArea::mousePressEvent(e);
+}
+
+void ConsoleView::mouseMoveEvent(QMouseEvent* e) {
+  if ((e->buttons() & Qt::LeftButton) && m_selAnchor.line >= 0) {
+    m_selEnd = posAt(e->pos());
+    viewport()->update();
+  }
+  QAbstractScrollArea::mouseMoveEvent(e);
+}
+
+void ConsoleView::keyPressEvent(QKeyEvent* e) {
+  if (e->matches(QKeySequence::SelectAll)) {
+    if (m_log.lineCount() > 0) {
+      m_selAnchor = TextPos{m_firstLineNumber, 0};
+      m_selEnd = TextPos{m_firstLineNumber + m_log.lineCount() - 1, INT_MAX};
+      viewport()->update();
+    }
+    return;
+  }
+  QAbstractScrollArea::keyPressEvent(e);
+}
+
+void ConsoleView::copy() {
+  if (m_selAnchor.line < 0)
+    return;
+  TextPos begin = std::min(m_selAnchor, m_selEnd);
+  const TextPos end = std::max(m_selAnchor, m_selEnd);
+  // Lines evicted since the selection was made are no longer available
+  if (begin.line < m_firstLineNumber)
+    begin = TextPos{m_firstLineNumber, 0};
+  const int first = int(begin.line - m_firstLineNumber);
+  const int last = int(std::min<qint64>(end.line - m_firstLineNumber, m_log.lineCount() - 1));
+  QString text;
+  for (int i = first; i <= last; ++i) {
+    const QString line = QString::fromUtf8(m_log.lineUtf8(i));
+    const int from = i == first ? std::min(begin.column, int(line.size())) : 0;
+    const int to = i == last && m_firstLineNumber + i == end.line ? std::min(end.column, int(line.size()))
+                                                                  : int(line.size());
+    text += line.mid(from, to - from);
+    if (i < last)
+      text += QLatin1Char{'\n'};
+  }
+  if (!text.isEmpty())
+    QApplication::clipboard()->setText(text);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+
+#include <QAbstractScrollArea>
+#include <QFont>
+#include <QFontMetrics>
+#include <QVector>
+
+#include "ConsoleLog.hpp"
+
+class TermFormatTable;
+
+/**
+ * Read-only console widget drawing ConsoleLog contents.
+ * Only the lines inside the viewport are decoded and painted, so cost is independent of the
+ * scrollback size. The view follows new output while scrolled to the bottom. Text can be
+ * selected by character across any number of lines and copied with the usual shortcut; tabs
+ * are expanded to the next multiple of TabWidth columns.
+ */
+class ConsoleView : public QAbstractScrollArea {
+  Q_OBJECT
+
+public:
+  static constexpr int TabWidth = 8;
+
+  explicit ConsoleView(QWidget* parent = Q_NULLPTR);
+
+  ConsoleLog& log() { return m_log; }
+  void setFormats(const TermFormatTable* formats);
+
+  // Call after writing to log()
+  void contentsChanged();
+  void clear();
+
+public slots:
+  void copy();
+
+protected:
+  void paintEvent(QPaintEvent* e) override;
+  void resizeEvent(QResizeEvent* e) override;
+  void changeEvent(QEvent* e) override;
+  void mousePressEvent(QMouseEvent* e) override;
+  void mouseMoveEvent(QMouseEvent* e) override;
+  void keyPressEvent(QKeyEvent* e) override;
+
+private:
+  // Absolute line number (ConsoleLog::firstLineNumber() based) and UTF-16 column in that line
+  struct TextPos {
+    qint64 line = -1;
+    int column = 0;
+    bool operator<(const TextPos& other) const {
+      return line < other.line || (line == other.line && column < other.column);
+    }
+  };
+
+  void updateScrollBars();
+  int visibleLines() const;
+  qint64 lineAt(int y) const;
+  TextPos posAt(const QPoint& pos);
+  int layoutLine(int line, std::vector<int>* boundaries);
+  struct SpanFont {
+    QFont font;
+    QFontMetrics metrics;
+  };
+  const SpanFont& fontFor(int format);
+
+  ConsoleLog m_log;
+  const TermFormatTable* m_formats = nullptr;
+  std::vector<SpanFont> m_fonts; // resolved per format index
+  QVector<ConsoleLog::Span> m_spans;
+  std::vector<int> m_boundaries;
+  qint64 m_firstLineNumber = 0;
+  int m_widestLine = 0; // pixels, as laid out so far; tabs can make lines wider than maxColumns()
+  // line is -1 without selection
+  TextPos m_selAnchor;
+  TextPos m_selEnd;
+};
@@ -1,11 +1,24 @@
 #include "DownloadManager.hpp"
+
+#include <algorithm>
+
 #include "Common.hpp"
+#include "ZipStreamExtractor.hpp"
 #include <quazip.h>
 
 #include <QDesktopServices>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
 
 #define KEY_PINNING 0
 
+constexpr qint64 ResumeCheckpointInterval = 8 * 1024 * 1024;
+constexpr int DefaultSegmentCount = 4;
+// Below this, the extra HEAD round trip costs more than parallel segments save
+constexpr qint64 MinSegmentedSize = 4 * 1024 * 1024;
+
 #if KEY_PINNING
 static const char AxioDLPublicKeyPEM[] =
     "-----BEGIN PUBLIC KEY-----\n"
@@ -48,6 +61,106 @@ void DownloadManager::_validateCert(QNetworkReply* reply) {
 static const QString Domain = QStringLiteral("https://releases.axiodl.com/");
 static const QString Index = QStringLiteral("index.txt");
 
+// Allows pointing the downloader at a local stand-in server (e.g. `python3 -m http.server`)
+static QString ReleasesDomain() {
+  QString domain = qEnvironmentVariable("HECL_RELEASES_URL", Domain);
+  if (!domain.endsWith(QLatin1Char{'/'}))
+    domain += QLatin1Char{'/'};
+  return domain;
+}
+
+/* Partial downloads are kept as <outPath>.part with a JSON sidecar recording enough
+ * to resume them with HTTP Range requests later. Segmented downloads also record each
+ * segment's range and how far it got, since the file holds data past the first gap. */
+static QString MetaPath(const QString& partPath) { return partPath + QStringLiteral(".json"); }
+
+void DownloadManager::_loadResumeState(const QUrl& url, std::vector<Segment>* segments) {
+  m_resumeOffset = 0;
+  m_binaryTotal = 0;
+  m_resumeValidator.clear();
+  segments->clear();
+
+  QFile metaFile(MetaPath(m_binaryFile.fileName()));
+  if (!metaFile.open(QIODevice::ReadOnly))
+    return;
+  const QJsonObject meta = QJsonDocument::fromJson(metaFile.readAll()).object();
+  if (meta.value(QStringLiteral("url")).toString() != url.toString())
+    return;
+
+  const QString validator = meta.value(QStringLiteral("etag")).toString();
+  const qint64 received = qint64(meta.value(QStringLiteral("received")).toDouble());
+  const qint64 fileSize = QFileInfo(m_binaryFile.fileName()).size();
+  if (validator.isEmpty())
+    return;
+
+  const QJsonArray savedSegments = meta.value(QStringLiteral("segments")).toArray();
+  if (!savedSegments.isEmpty()) {
+    const qint64 size = qint64(meta.value(QStringLiteral("size")).toDouble());
+    if (size <= 0 || fileSize < size)
+      return;
+    for (const QJsonValue& value : savedSegments) {
+      const QJsonArray range = value.toArray();
+      if (range.size() != 3) {
+        segments->clear();
+        return;
+      }
+      const qint64 start = qint64(range.at(0).toDouble());
+      const qint64 end = qint64(range.at(1).toDouble());
+      const qint64 pos = qint64(range.at(2).toDouble());
+      if (start < 0 || end >= size || pos < start || pos > end + 1) {
+        segments->clear();
+        return;
+      }
+      segments->push_back({nullptr, start, end, pos});
+    }
+    m_binaryTotal = size;
+  } else if (received <= 0 || fileSize < received) {
+    // Bytes beyond the last recorded count may not have been flushed before a crash
+    return;
+  }
+
+  m_resumeOffset = std::max<qint64>(received, 0);
+  m_resumeValidator = validator;
+}
+
+void DownloadManager::_saveResumeState() {
+  if ((m_binaryInProgress == nullptr && m_segments.empty()) || m_resumeValidator.isEmpty())
+    return;
+  m_binaryFile.flush();
+
+  QJsonObject meta;
+  meta.insert(QStringLiteral("url"), m_binaryUrl.toString());
+  meta.insert(QStringLiteral("etag"), m_resumeValidator);
+  if (m_segments.empty()) {
+    meta.insert(QStringLiteral("received"), double(m_binaryFile.size()));
+    m_lastSavedOffset = m_binaryFile.size();
+  } else {
+    qint64 received = 0;
+    qint64 contiguous = -1;
+    QJsonArray segments;
+    for (const Segment& seg : m_segments) {
+      received += seg.pos - seg.start;
+      if (contiguous < 0 && seg.pos != seg.end + 1)
+        contiguous = seg.pos;
+      segments.append(QJsonArray{double(seg.start), double(seg.end), double(seg.pos)});
+    }
+    meta.insert(QStringLiteral("received"), double(contiguous < 0 ? m_binaryTotal : contiguous));
+    meta.insert(QStringLiteral("size"), double(m_binaryTotal));
+    meta.insert(QStringLiteral("segments"), segments);
+    m_lastSavedOffset = received;
+  }
+
+  QSaveFile metaFile(MetaPath(m_binaryFile.fileName()));
+  if (metaFile.open(QIODevice::WriteOnly)) {
+    metaFile.write(QJsonDocument(meta).toJson(QJsonDocument::Compact));
+    metaFile.commit();
+  }
+}
+
+DownloadManager::DownloadManager(QObject* parent) : QObject(parent), m_netManager(this) {}
+
+DownloadManager::~DownloadManager() = default;
+
 void DownloadManager::fetchIndex() {
   if (m_indexInProgress != nullptr) {
     return;
@@ -55,8 +168,9 @@ void DownloadManager::fetchIndex() {
 
   resetError();
 
-  const QString track = QSettings().value(QStringLiteral("update_track")).toString();
-  const auto url = QUrl(QStringLiteral("%1%2/%3/%4").arg(Domain, track, CurPlatformString, Index));
+  const QString track =
+      m_track.isEmpty() ? QSettings().value(QStringLiteral("update_track")).toString() : m_track;
+  const auto url = QUrl(QStringLiteral("%1%2/%3/%4").arg(ReleasesDomain(), track, CurPlatformString, Index));
 
   m_indexInProgress = m_netManager.get(QNetworkRequest(url));
   connect(m_indexInProgress, &QNetworkReply::finished, this, &DownloadManager::indexFinished);
@@ -69,18 +183,72 @@ void DownloadManager::fetchIndex() {
   connect(m_indexInProgress, &QNetworkReply::encrypted, this, &DownloadManager::indexValidateCert);
 }
 
-void DownloadManager::fetchBinary(const QString& str, const QString& outPath) {
-  if (m_binaryInProgress != nullptr) {
+void DownloadManager::fetchBinary(const QString& str, const QString& outPath, const QString& extractDir) {
+  if (m_binaryInProgress != nullptr || !m_segments.empty()) {
     return;
   }
 
   resetError();
   m_outPath = outPath;
+  m_extractDir = extractDir;
+
+  const QString track =
+      m_track.isEmpty() ? QSettings().value(QStringLiteral("update_track")).toString() : m_track;
+  const auto url = QUrl(QStringLiteral("%1%2/%3/%4").arg(ReleasesDomain(), track, CurPlatformString, str));
+  if (!m_zipDownload) {
+    QDesktopServices::openUrl(url);
+    return;
+  }
 
-  const QString track = QSettings().value(QStringLiteral("update_track")).toString();
-  const auto url = QUrl(QStringLiteral("%1%2/%3/%4").arg(Domain, track, CurPlatformString, str));
-#if PLATFORM_ZIP_DOWNLOAD
-  m_binaryInProgress = m_netManager.get(QNetworkRequest(url));
+  m_binaryUrl = url;
+
+  // Archive is streamed to a temporary file next to the destination so memory use stays flat
+  m_binaryFile.setFileName(m_outPath + QStringLiteral(".part"));
+  std::vector<Segment> resumeSegments;
+  _loadResumeState(url, &resumeSegments);
+  // A segmented partial file keeps its full preallocated size; data past the first gap is still good
+  const qint64 keepSize = resumeSegments.empty() ? m_resumeOffset : m_binaryTotal;
+  if (!m_binaryFile.open(QIODevice::ReadWrite) || !m_binaryFile.resize(keepSize) ||
+      !m_binaryFile.seek(m_resumeOffset)) {
+    setError(QNetworkReply::UnknownContentError, tr("Unable to create %1").arg(m_binaryFile.fileName()));
+    m_binaryFile.close();
+    if (m_failedHandler)
+      m_failedHandler();
+    return;
+  }
+
+  // Extract while downloading; a resumed download replays its partial file first
+  _resetExtractor();
+  _pumpExtractor(m_resumeOffset);
+
+  const int segmentCount = QSettings().value(QStringLiteral("download_segments"), DefaultSegmentCount).toInt();
+  if (!resumeSegments.empty()) {
+    // Progress is counted per segment, not on top of a resumed prefix
+    m_resumeOffset = 0;
+    _startSegments(std::move(resumeSegments));
+  } else if (m_resumeOffset == 0 && segmentCount > 1) {
+    _probeBinary(segmentCount);
+  } else {
+    _startSingleStream();
+  }
+
+  if (m_progBar != nullptr) {
+    m_progBar->setEnabled(true);
+    m_progBar->setValue(0);
+  }
+}
+
+void DownloadManager::_startSingleStream() {
+  QNetworkRequest request(m_binaryUrl);
+  if (m_resumeOffset > 0) {
+    request.setRawHeader("Range", QByteArrayLiteral("bytes=") + QByteArray::number(m_resumeOffset) + '-');
+    request.setRawHeader("If-Range", m_resumeValidator.toUtf8());
+  }
+  m_lastSavedOffset = m_resumeOffset;
+
+  m_binaryInProgress = m_netManager.get(request);
+  connect(m_binaryInProgress, &QNetworkReply::metaDataChanged, this, &DownloadManager::binaryMetaDataChanged);
+  connect(m_binaryInProgress, &QNetworkReply::readyRead, this, &DownloadManager::binaryReadyRead);
   connect(m_binaryInProgress, &QNetworkReply::finished, this, &DownloadManager::binaryFinished);
 #if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
   connect(m_binaryInProgress, &QNetworkReply::errorOccurred, this, &DownloadManager::binaryError);
@@ -90,14 +258,200 @@ void DownloadManager::fetchBinary(const QString& str, const QString& outPath) {
 #endif
   connect(m_binaryInProgress, &QNetworkReply::encrypted, this, &DownloadManager::binaryValidateCert);
   connect(m_binaryInProgress, &QNetworkReply::downloadProgress, this, &DownloadManager::binaryDownloadProgress);
+}
 
-  if (m_progBar != nullptr) {
-    m_progBar->setEnabled(true);
-    m_progBar->setValue(0);
+/* Segmented downloads: a HEAD request learns the archive size and whether the server honors
+ * byte ranges, then the file is preallocated and split into contiguous ranges fetched concurrently.
+ * A server that answers a range with a plain 200 drops us back to a single stream. */
+void DownloadManager::_probeBinary(int segmentCount) {
+  m_binaryInProgress = m_netManager.head(QNetworkRequest(m_binaryUrl));
+  connect(m_binaryInProgress, &QNetworkReply::finished, this,
+          [this, segmentCount] { binaryProbeFinished(segmentCount); });
+  connect(m_binaryInProgress, &QNetworkReply::encrypted, this, &DownloadManager::binaryValidateCert);
+}
+
+void DownloadManager::binaryProbeFinished(int segmentCount) {
+  QNetworkReply* probe = m_binaryInProgress;
+  m_binaryInProgress = nullptr;
+  probe->deleteLater();
+
+  if (m_hasError) {
+    // Certificate validation rejected the server
+    _failSegments(false);
+    return;
   }
+
+  const qint64 length = probe->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+  if (probe->error() != QNetworkReply::NoError || !probe->rawHeader("Accept-Ranges").contains("bytes") ||
+      length < MinSegmentedSize || !m_binaryFile.resize(length)) {
+    // Let the plain GET report any real error
+    _startSingleStream();
+    return;
+  }
+
+  m_binaryTotal = length;
+  m_resumeValidator = _readValidator(probe);
+  std::vector<Segment> segments;
+  const qint64 segmentSize = (length + segmentCount - 1) / segmentCount;
+  for (qint64 start = 0; start < length; start += segmentSize)
+    segments.push_back({nullptr, start, std::min(start + segmentSize, length) - 1, start});
+  _startSegments(std::move(segments));
+}
+
+void DownloadManager::_startSegments(std::vector<Segment>&& segments) {
+  m_segments = std::move(segments);
+  m_lastSavedOffset = 0;
+  for (Segment& seg : m_segments) {
+    m_lastSavedOffset += seg.pos - seg.start;
+    if (seg.pos == seg.end + 1)
+      continue; // finished in a previous session
+
+    QNetworkRequest request(m_binaryUrl);
+    request.setRawHeader("Range", QByteArrayLiteral("bytes=") + QByteArray::number(seg.pos) + '-' +
+                                      QByteArray::number(seg.end));
+    if (!m_resumeValidator.isEmpty())
+      request.setRawHeader("If-Range", m_resumeValidator.toUtf8());
+
+    QNetworkReply* reply = m_netManager.get(request);
+    seg.reply = reply;
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply] { segmentMetaDataChanged(reply); });
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply] { segmentReadyRead(reply); });
+    connect(reply, &QNetworkReply::finished, this, [this, reply] { segmentFinished(reply); });
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    connect(reply, &QNetworkReply::errorOccurred, this,
+            [this, reply](QNetworkReply::NetworkError error) { segmentError(reply, error); });
 #else
-  QDesktopServices::openUrl(url);
+    connect(reply, qOverload<QNetworkReply::NetworkError>(&QNetworkReply::error), this,
+            [this, reply](QNetworkReply::NetworkError error) { segmentError(reply, error); });
 #endif
+    connect(reply, &QNetworkReply::encrypted, this, [this, reply] { _validateCert(reply); });
+  }
+
+  if (std::all_of(m_segments.cbegin(), m_segments.cend(), [](const Segment& s) { return s.reply == nullptr; })) {
+    // Every range arrived before the previous session stopped
+    m_segments.clear();
+    _finishBinary();
+  }
+}
+
+DownloadManager::Segment* DownloadManager::_findSegment(QNetworkReply* reply) {
+  for (Segment& seg : m_segments)
+    if (seg.reply == reply)
+      return &seg;
+  return nullptr;
+}
+
+void DownloadManager::_abortSegments() {
+  for (Segment& seg : m_segments) {
+    if (seg.reply != nullptr) {
+      disconnect(seg.reply, nullptr, this, nullptr);
+      seg.reply->abort();
+      seg.reply->deleteLater();
+    }
+  }
+  m_segments.clear();
+}
+
+void DownloadManager::_failSegments(bool keepPartial) {
+  if (keepPartial) {
+    // Record every segment's progress so the next fetchBinary only requests what's missing
+    _saveResumeState();
+    _abortSegments();
+    m_extractor.reset();
+    m_binaryFile.close();
+  } else {
+    _abortSegments();
+    _discardBinaryFile();
+  }
+
+  if (m_progBar)
+    m_progBar->setEnabled(false);
+
+  if (m_failedHandler)
+    m_failedHandler();
+}
+
+void DownloadManager::segmentMetaDataChanged(QNetworkReply* reply) {
+  const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if (status == 206 || reply->error() != QNetworkReply::NoError)
+    return;
+  if (status != 200) {
+    // An error status on one range fails it now, before its body lands in the part file; the
+    // other segments keep their progress for the next attempt
+    setError(QNetworkReply::UnknownServerError, tr("Server returned HTTP %1").arg(status));
+    _failSegments(status != 416);
+    return;
+  }
+
+  // Server ignored Range (or the file changed between requests); fall back to one stream
+  _abortSegments();
+  m_binaryTotal = 0;
+  if (!m_binaryFile.resize(0) || !m_binaryFile.seek(0)) {
+    setError(QNetworkReply::UnknownContentError, tr("Unable to write %1").arg(m_binaryFile.fileName()));
+    _failSegments(false);
+    return;
+  }
+  _resetExtractor();
+  _startSingleStream();
+}
+
+void DownloadManager::segmentReadyRead(QNetworkReply* reply) {
+  Segment* seg = _findSegment(reply);
+  if (seg == nullptr || m_hasError)
+    return;
+
+  const QByteArray chunk = reply->readAll();
+  if (seg->pos + chunk.size() > seg->end + 1 || !m_binaryFile.seek(seg->pos) ||
+      m_binaryFile.write(chunk) != chunk.size()) {
+    // Only the failed chunk is lost; everything before seg->pos was written
+    setError(QNetworkReply::UnknownContentError, tr("Unable to write %1").arg(m_binaryFile.fileName()));
+    _failSegments(true);
+    return;
+  }
+  _feedExtractor(seg->pos, chunk);
+  seg->pos += chunk.size();
+
+  // Segments are ordered by offset; extract up to the end of the contiguous prefix
+  qint64 received = 0;
+  qint64 contiguous = -1;
+  for (const Segment& s : m_segments) {
+    received += s.pos - s.start;
+    if (contiguous < 0 && s.pos != s.end + 1)
+      contiguous = s.pos;
+  }
+  _pumpExtractor(contiguous < 0 ? m_binaryTotal : contiguous);
+  binaryDownloadProgress(received, m_binaryTotal);
+  if (received - m_lastSavedOffset >= ResumeCheckpointInterval)
+    _saveResumeState();
+}
+
+void DownloadManager::segmentFinished(QNetworkReply* reply) {
+  Segment* seg = _findSegment(reply);
+  if (seg == nullptr || m_hasError)
+    return;
+
+  segmentReadyRead(reply);
+  if (m_hasError)
+    return;
+  if (seg->pos != seg->end + 1) {
+    setError(QNetworkReply::UnknownContentError, tr("Download ended early"));
+    _failSegments(true);
+    return;
+  }
+
+  seg->reply->deleteLater();
+  seg->reply = nullptr;
+  if (std::all_of(m_segments.cbegin(), m_segments.cend(), [](const Segment& s) { return s.reply == nullptr; })) {
+    m_segments.clear();
+    _finishBinary();
+  }
+}
+
+void DownloadManager::segmentError(QNetworkReply* reply, QNetworkReply::NetworkError error) {
+  setError(error, reply->errorString());
+  // Same rules as a single stream: a rejected range or local abort can't be resumed
+  const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  _failSegments(status != 416 && error != QNetworkReply::OperationCanceledError);
 }
 
 void DownloadManager::indexFinished() {
@@ -128,32 +482,162 @@ void DownloadManager::indexError(QNetworkReply::NetworkError error) {
 
 void DownloadManager::indexValidateCert() { _validateCert(m_indexInProgress); }
 
+void DownloadManager::_discardBinaryFile() {
+  m_extractor.reset();
+  if (m_binaryFile.isOpen())
+    m_binaryFile.close();
+  if (!m_binaryFile.fileName().isEmpty()) {
+    m_binaryFile.remove();
+    QFile::remove(MetaPath(m_binaryFile.fileName()));
+  }
+}
+
+void DownloadManager::binaryMetaDataChanged() {
+  const int status = m_binaryInProgress->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  // Qt reports an HTTP error only once the reply finishes; until then the partial file and its
+  // validator are left as they are so a transient failure can still be resumed
+  if (status >= 400)
+    return;
+  if (status == 200 && m_resumeOffset > 0) {
+    // Server ignored Range or the If-Range validator no longer matches; start over
+    m_resumeOffset = 0;
+    m_binaryFile.resize(0);
+    m_binaryFile.seek(0);
+    _resetExtractor();
+  }
+
+  m_resumeValidator = _readValidator(m_binaryInProgress);
+}
+
+QString DownloadManager::_readValidator(QNetworkReply* reply) {
+  // Prefer the strong ETag; fall back to Last-Modified which is also valid for If-Range
+  QByteArray validator = reply->rawHeader("ETag");
+  if (validator.isEmpty() || validator.startsWith("W/"))
+    validator = reply->rawHeader("Last-Modified");
+  return QString::fromUtf8(validator);
+}
+
+void DownloadManager::_resetExtractor() {
+  m_extractor.reset();
+  m_extractFed = 0;
+  if (!m_extractDir.isEmpty())
+    m_extractor = std::make_unique<ZipStreamExtractor>(m_extractDir);
+}
+
+void DownloadManager::_feedExtractor(qint64 offset, const QByteArray& chunk) {
+  if (!m_extractor || offset != m_extractFed)
+    return;
+
+  if (!m_extractor->feed(chunk.constData(), chunk.size())) {
+    // Not fatal: the completion handler extracts from the finished archive instead
+    qWarning() << "Streaming extraction disabled:" << m_extractor->errorString();
+    m_extractor.reset();
+    return;
+  }
+  m_extractFed += chunk.size();
+}
+
+void DownloadManager::_pumpExtractor(qint64 end) {
+  if (!m_extractor || m_extractFed >= end)
+    return;
+
+  // Replay bytes that were written out of order (or in a previous session) from the part file
+  const qint64 savedPos = m_binaryFile.pos();
+  m_binaryFile.flush();
+  m_binaryFile.seek(m_extractFed);
+  while (m_extractor && m_extractFed < end) {
+    const QByteArray chunk = m_binaryFile.read(std::min<qint64>(end - m_extractFed, 1024 * 1024));
+    if (chunk.isEmpty()) {
+      m_extractor.reset();
+      break;
+    }
+    _feedExtractor(m_extractFed, chunk);
+  }
+  m_binaryFile.seek(savedPos);
+}
+
+bool DownloadManager::_writeBinaryChunk() {
+  const QByteArray chunk = m_binaryInProgress->readAll();
+  // The body of an error response is not part of the archive
+  if (m_binaryInProgress->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() >= 400)
+    return true;
+  const qint64 offset = m_binaryFile.pos();
+  if (m_binaryFile.write(chunk) != chunk.size()) {
+    setError(QNetworkReply::UnknownContentError, tr("Unable to write %1").arg(m_binaryFile.fileName()));
+    return false;
+  }
+  _feedExtractor(offset, chunk);
+  // Checkpoint periodically so a crash loses at most a few MiB
+  if (m_binaryFile.pos() - m_lastSavedOffset >= ResumeCheckpointInterval)
+    _saveResumeState();
+  return true;
+}
+
+void DownloadManager::binaryReadyRead() {
+  if (m_hasError)
+    return;
+
+  if (!_writeBinaryChunk())
+    m_binaryInProgress->abort();
+}
+
 void DownloadManager::binaryFinished() {
   if (m_hasError)
     return;
 
+  const bool written = _writeBinaryChunk();
+  m_binaryInProgress->deleteLater();
+  m_binaryInProgress = nullptr;
+  if (!written) {
+    _discardBinaryFile();
+    return;
+  }
+
+  _finishBinary();
+}
+
+void DownloadManager::_finishBinary() {
   if (m_progBar)
     m_progBar->setValue(100);
 
-  QByteArray all = m_binaryInProgress->readAll();
-  QBuffer buff(&all);
-  QuaZip zip(&buff);
-  if (!zip.open(QuaZip::mdUnzip)) {
-    setError(QNetworkReply::UnknownContentError, tr("Unable to open zip archive."));
-    m_binaryInProgress->deleteLater();
-    m_binaryInProgress = nullptr;
+  if (!m_binaryFile.flush()) {
+    setError(QNetworkReply::UnknownContentError, tr("Unable to write %1").arg(m_binaryFile.fileName()));
+    _discardBinaryFile();
     return;
   }
+  m_binaryFile.close();
 
-  if (m_completionHandler)
-    m_completionHandler(zip);
+  const bool extracted = m_extractor && m_extractor->finish();
+  m_extractor.reset();
 
-  m_binaryInProgress->deleteLater();
-  m_binaryInProgress = nullptr;
+  {
+    QuaZip zip(m_binaryFile.fileName());
+    if (!zip.open(QuaZip::mdUnzip)) {
+      setError(QNetworkReply::UnknownContentError, tr("Unable to open zip archive."));
+      _discardBinaryFile();
+      return;
+    }
+  }
+
+  // The archive now belongs to the completion handler, which installs it off this thread and removes it
+  QFile::remove(MetaPath(m_binaryFile.fileName()));
+  if (m_completionHandler)
+    m_completionHandler(m_binaryFile.fileName(), extracted);
+  else
+    m_binaryFile.remove();
 }
 
 void DownloadManager::binaryError(QNetworkReply::NetworkError error) {
   setError(error, m_binaryInProgress->errorString());
+  const int status = m_binaryInProgress->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if (status == 416 || error == QNetworkReply::OperationCanceledError) {
+    // Range not satisfiable or local failure; the partial file can't be trusted
+    _discardBinaryFile();
+  } else {
+    // Keep what we have so the next fetchBinary can resume with a Range request
+    _saveResumeState();
+    m_binaryFile.close();
+  }
   m_binaryInProgress->deleteLater();
   m_binaryInProgress = nullptr;
 
@@ -167,6 +651,11 @@ void DownloadManager::binaryError(QNetworkReply::NetworkError error) {
 void DownloadManager::binaryValidateCert() { _validateCert(m_binaryInProgress); }
 
 void DownloadManager::binaryDownloadProgress(qint64 bytesReceived, qint64 bytesTotal) {
+  if (bytesTotal <= 0)
+    return;
+  bytesReceived += m_resumeOffset;
+  bytesTotal += m_resumeOffset;
+  emit binaryProgress(bytesReceived, bytesTotal);
   if (m_progBar) {
     if (bytesReceived == bytesTotal)
       m_progBar->setValue(100);
@@ -1,30 +1,52 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include <QObject>
 #include <QtNetwork>
 #include <QNetworkAccessManager>
 #include <QProgressBar>
 #include <QLabel>
 
+// Default for DownloadManager::setZipDownload(); the GUI otherwise sends users to the release page
 //#if _WIN32
 //#define PLATFORM_ZIP_DOWNLOAD 1
 //#else
 #define PLATFORM_ZIP_DOWNLOAD 0
 //#endif
 
-class QuaZip;
+class ZipStreamExtractor;
 
 class DownloadManager : public QObject {
   Q_OBJECT
   QNetworkAccessManager m_netManager;
   QNetworkReply* m_indexInProgress = nullptr;
   QNetworkReply* m_binaryInProgress = nullptr;
+  struct Segment {
+    QNetworkReply* reply;
+    qint64 start;
+    qint64 end; // inclusive, as in the Range header
+    qint64 pos;
+  };
+  std::vector<Segment> m_segments;
+  qint64 m_binaryTotal = 0;
+  QUrl m_binaryUrl;
   QString m_outPath;
+  QString m_extractDir;
+  QFile m_binaryFile;
+  std::unique_ptr<ZipStreamExtractor> m_extractor;
+  qint64 m_extractFed = 0;
+  qint64 m_resumeOffset = 0;
+  qint64 m_lastSavedOffset = 0;
+  QString m_resumeValidator;
+  QString m_track;
+  bool m_zipDownload = PLATFORM_ZIP_DOWNLOAD;
   bool m_hasError = false;
   QProgressBar* m_progBar = nullptr;
   QLabel* m_errorLabel = nullptr;
   std::function<void(const QStringList& index)> m_indexCompletionHandler;
-  std::function<void(QuaZip& file)> m_completionHandler;
+  std::function<void(const QString& archivePath, bool extracted)> m_completionHandler;
   std::function<void()> m_failedHandler;
 
   void resetError() {
@@ -39,30 +61,65 @@ class DownloadManager : public QObject {
     m_hasError = true;
     if (m_errorLabel)
       m_errorLabel->setText(errStr);
+    emit errorOccurred(errStr);
   }
 
   void _validateCert(QNetworkReply* reply);
+  void _loadResumeState(const QUrl& url, std::vector<Segment>* segments);
+  void _saveResumeState();
+  static QString _readValidator(QNetworkReply* reply);
+  void _startSingleStream();
+  void _probeBinary(int segmentCount);
+  void _startSegments(std::vector<Segment>&& segments);
+  Segment* _findSegment(QNetworkReply* reply);
+  void _abortSegments();
+  void _failSegments(bool keepPartial);
+  void segmentMetaDataChanged(QNetworkReply* reply);
+  void segmentReadyRead(QNetworkReply* reply);
+  void segmentFinished(QNetworkReply* reply);
+  void segmentError(QNetworkReply* reply, QNetworkReply::NetworkError error);
+  void _resetExtractor();
+  void _feedExtractor(qint64 offset, const QByteArray& chunk);
+  void _pumpExtractor(qint64 end);
+  void _finishBinary();
+  bool _writeBinaryChunk();
+  void _discardBinaryFile();
 
 public:
-  explicit DownloadManager(QObject* parent = Q_NULLPTR) : QObject(parent), m_netManager(this) {}
+  explicit DownloadManager(QObject* parent = Q_NULLPTR);
+  ~DownloadManager() override;
   void connectWidgets(QProgressBar* progBar, QLabel* errorLabel,
                       std::function<void(const QStringList& index)>&& indexCompletionHandler,
-                      std::function<void(QuaZip& file)>&& completionHandler, std::function<void()>&& failedHandler) {
+                      std::function<void(const QString& archivePath, bool extracted)>&& completionHandler,
+                      std::function<void()>&& failedHandler) {
     m_progBar = progBar;
     m_errorLabel = errorLabel;
     m_indexCompletionHandler = std::move(indexCompletionHandler);
     m_completionHandler = std::move(completionHandler);
     m_failedHandler = std::move(failedHandler);
   }
+  // Overrides the update_track setting; empty to follow it again
+  void setTrack(const QString& track) { m_track = track; }
+  // Download and extract archives in-process instead of opening the release URL in a browser
+  void setZipDownload(bool enabled) { m_zipDownload = enabled; }
+  bool zipDownload() const { return m_zipDownload; }
   void fetchIndex();
-  void fetchBinary(const QString& str, const QString& outPath);
+  void fetchBinary(const QString& str, const QString& outPath, const QString& extractDir = {});
   bool hasError() const { return m_hasError; }
 
+signals:
+  // For use without widgets; the same information goes to the progress bar and error label
+  void errorOccurred(const QString& message);
+  void binaryProgress(qint64 bytesReceived, qint64 bytesTotal);
+
 public slots:
   void indexFinished();
   void indexError(QNetworkReply::NetworkError error);
   void indexValidateCert();
 
+  void binaryProbeFinished(int segmentCount);
+  void binaryMetaDataChanged();
+  void binaryReadyRead();
   void binaryFinished();
   void binaryError(QNetworkReply::NetworkError error);
   void binaryValidateCert();
@@ -1,12 +1,43 @@
 #pragma once
 
-#include <QString>
-#include <QTextCharFormat>
-#include <QTextCursor>
+#include <QColor>
+#include <QtGlobal>
 
-void ParseEscapeSequence(int attribute, QListIterator<QString>& i, QTextCharFormat& textCharFormat,
-                         const QTextCharFormat& defaultTextCharFormat);
+/* Walks the numeric parameters of one SGR sequence; extended colors consume several at once */
+class EscapeParamIterator {
+  const int* m_it;
+  const int* m_end;
 
-void ReturnInsert(QTextCursor& cur, const QString& text);
+public:
+  EscapeParamIterator(const int* begin, const int* end) : m_it(begin), m_end(end) {}
+  bool hasNext() const { return m_it != m_end; }
+  int next() { return *m_it++; }
+};
 
-void ReturnInsert(QTextCursor& cur, const QString& text, const QTextCharFormat& format);
+/* SGR state of the console, small enough to be hashed by value; see TermFormatTable */
+struct TermFormat {
+  enum class Weight : quint8 { Default, Light, Normal, Bold, Black };
+
+  // 0 means the console default; otherwise Explicit | 0xRRGGBB
+  static constexpr quint32 Explicit = 1u << 24;
+  quint32 foreground = 0;
+  quint32 background = 0;
+  Weight weight = Weight::Default;
+  quint8 fontStyle = 0; // 0 for the primary font, else 1 + index into the family's styles
+  bool italic = false;
+  bool underline = false;
+  bool strikeOut = false;
+
+  static quint32 color(QRgb rgb) { return Explicit | (rgb & 0xFFFFFF); }
+  void setForeground(const QColor& c) { foreground = color(c.rgb()); }
+  void setBackground(const QColor& c) { background = color(c.rgb()); }
+
+  quint64 key() const {
+    return quint64(foreground) | quint64(background) << 25 | quint64(weight) << 50 | quint64(fontStyle) << 53 |
+           quint64(italic) << 57 | quint64(underline) << 58 | quint64(strikeOut) << 59;
+  }
+  bool operator==(const TermFormat& other) const { return key() == other.key(); }
+  bool operator!=(const TermFormat& other) const { return key() != other.key(); }
+};
+
+void ParseEscapeSequence(int attribute, EscapeParamIterator& i, TermFormat& format);
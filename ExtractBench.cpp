@@ -0,0 +1,231 @@
+/*
+ * Times release archive extraction on a synthetic archive, against the original 4 KiB copy loop.
+ *
+ *   hecl-gui-extract-bench [--size MiB] [--entry MiB] [--repeat N] [--threads N] [--keep] [workdir]
+ *
+ * The archive alternates stored and deflated entries (the deflated ones compress roughly 2:1)
+ * and is built once in workdir (default: a temporary directory), then reused while its
+ * size matches. Every case extracts it into a fresh directory and the best of N runs is
+ * reported as MiB/s of uncompressed output. Archives of 2 GiB or more can't be mapped with a
+ * Qt 5 QByteArray, so stored entries in them go through the buffered copy as well.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTemporaryDir>
+
+#include <quazip.h>
+#include <quazipfile.h>
+#include <quazipnewinfo.h>
+
+#include "ExtractZip.hpp"
+
+namespace {
+struct Options {
+  qint64 totalMiB = 2048;
+  qint64 entryMiB = 64;
+  int repeat = 1;
+  int threads = 0;
+  bool keep = false;
+  QString workDir;
+};
+
+constexpr qint64 MiB = 1024 * 1024;
+constexpr qint64 BlockSize = 64 * 1024;
+
+/* Half pseudo-random, half repeated text, so deflate has something to do in both directions */
+void FillBlock(QByteArray& block, quint64& state) {
+  block.resize(int(BlockSize));
+  char* data = block.data();
+  for (qint64 i = 0; i < BlockSize / 2; i += 8) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    std::copy_n(reinterpret_cast<const char*>(&state), 8, data + i);
+  }
+  static const char Text[] = "MP1/Metroid1.upak CMDL TXTR ANCS PART ";
+  for (qint64 i = BlockSize / 2; i < BlockSize; ++i)
+    data[i] = Text[i % (sizeof(Text) - 1)];
+}
+
+bool BuildArchive(const QString& path, const Options& options) {
+  QuaZip zip(path);
+  zip.setZip64Enabled(true);
+  if (!zip.open(QuaZip::mdCreate))
+    return false;
+
+  quint64 state = 0x9E3779B97F4A7C15ULL;
+  QByteArray block;
+  const qint64 entryCount = std::max<qint64>(1, options.totalMiB / options.entryMiB);
+  for (qint64 entry = 0; entry < entryCount; ++entry) {
+    const bool stored = entry % 2 == 0;
+    QuaZipFile out(&zip);
+    const QString kind = stored ? QStringLiteral("stored") : QStringLiteral("deflated");
+    const QuaZipNewInfo info(QStringLiteral("bin/%1-%2.dat").arg(kind).arg(entry));
+    if (!out.open(QIODevice::WriteOnly, info, nullptr, 0, stored ? 0 : Z_DEFLATED, stored ? 0 : Z_BEST_SPEED))
+      return false;
+    for (qint64 written = 0; written < options.entryMiB * MiB; written += BlockSize) {
+      FillBlock(block, state);
+      if (out.write(block) != block.size())
+        return false;
+    }
+    out.close();
+    if (out.getZipError() != ZIP_OK)
+      return false;
+  }
+  zip.close();
+  return zip.getZipError() == ZIP_OK;
+}
+
+/* The extraction loop as it was before copy buffers were enlarged and stored entries mapped */
+bool ExtractBaseline(QuaZip& zip, const QString& dir) {
+  const QDir directory(dir);
+  for (bool more = zip.goToFirstFile(); more; more = zip.goToNextFile()) {
+    const QString dest = directory.absoluteFilePath(zip.getCurrentFileName());
+    QuaZipFile inFile(&zip);
+    if (!inFile.open(QIODevice::ReadOnly) || !QDir().mkpath(QFileInfo(dest).absolutePath()))
+      return false;
+    QFile outFile(dest);
+    if (!outFile.open(QIODevice::WriteOnly))
+      return false;
+    while (!inFile.atEnd()) {
+      char buf[4096];
+      const qint64 readLen = inFile.read(buf, 4096);
+      if (readLen <= 0 || outFile.write(buf, readLen) != readLen)
+        return false;
+    }
+    inFile.close();
+    if (inFile.getZipError() != UNZ_OK)
+      return false;
+  }
+  return true;
+}
+
+bool ParseArgs(const QStringList& args, Options& options) {
+  for (int i = 1; i < args.size(); ++i) {
+    const QString& arg = args[i];
+    if (arg == QStringLiteral("--size") && i + 1 < args.size()) {
+      options.totalMiB = args[++i].toLongLong();
+    } else if (arg == QStringLiteral("--entry") && i + 1 < args.size()) {
+      options.entryMiB = args[++i].toLongLong();
+    } else if (arg == QStringLiteral("--repeat") && i + 1 < args.size()) {
+      options.repeat = std::max(1, args[++i].toInt());
+    } else if (arg == QStringLiteral("--threads") && i + 1 < args.size()) {
+      options.threads = args[++i].toInt();
+    } else if (arg == QStringLiteral("--keep")) {
+      options.keep = true;
+    } else if (arg.startsWith(QStringLiteral("--")) || !options.workDir.isEmpty()) {
+      return false;
+    } else {
+      options.workDir = arg;
+    }
+  }
+  return options.totalMiB > 0 && options.entryMiB > 0;
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+
+  Options options;
+  if (!ParseArgs(QCoreApplication::arguments(), options)) {
+    std::fprintf(stderr, "usage: %s [--size MiB] [--entry MiB] [--repeat N] [--threads N] [--keep] [workdir]\n",
+                 argv[0]);
+    return 2;
+  }
+
+  QTemporaryDir tempDir;
+  tempDir.setAutoRemove(!options.keep);
+  const QDir work(options.workDir.isEmpty() ? tempDir.path() : options.workDir);
+  if (!QDir().mkpath(work.absolutePath())) {
+    std::fprintf(stderr, "unable to create %s\n", qUtf8Printable(work.absolutePath()));
+    return 1;
+  }
+
+  const QString archivePath = work.absoluteFilePath(
+      QStringLiteral("synthetic-%1-%2.zip").arg(options.totalMiB).arg(options.entryMiB));
+  if (!QFileInfo::exists(archivePath)) {
+    std::printf("building %s\n", qUtf8Printable(archivePath));
+    if (!BuildArchive(archivePath, options)) {
+      QFile::remove(archivePath);
+      std::fprintf(stderr, "unable to build the archive\n");
+      return 1;
+    }
+  }
+
+  const qint64 archiveSize = QFileInfo(archivePath).size();
+  const double mebibytes = double(std::max<qint64>(1, options.totalMiB / options.entryMiB) * options.entryMiB);
+  std::printf("archive: %.1f MiB on disk, %.0f MiB extracted%s\n", archiveSize / double(MiB), mebibytes,
+              archiveSize >= INT_MAX ? " (too large to map; stored entries are copied)" : "");
+  {
+    // Warm the page cache so the first case isn't charged for reading the archive from disk
+    QFile archive(archivePath);
+    if (archive.open(QIODevice::ReadOnly))
+      while (!archive.read(16 * MiB).isEmpty()) {
+      }
+  }
+
+  using Extractor = std::function<bool(QuaZip& zip, const QString& dir)>;
+  const std::vector<std::pair<const char*, Extractor>> cases = {
+      {"baseline 4 KiB", ExtractBaseline},
+      {"extractDir 4 KiB",
+       [](QuaZip& zip, const QString& dir) {
+         ExtractZip::setCopyBufferSize(4096);
+         return ExtractZip::extractDir(zip, dir);
+       }},
+      {"extractDir",
+       [](QuaZip& zip, const QString& dir) {
+         ExtractZip::setCopyBufferSize(1024 * 1024);
+         return ExtractZip::extractDir(zip, dir);
+       }},
+      {"extractDirParallel",
+       [&options](QuaZip& zip, const QString& dir) {
+         ExtractZip::setCopyBufferSize(1024 * 1024);
+         return ExtractZip::extractDirParallel(zip, dir, options.threads);
+       }},
+  };
+
+  std::printf("%-24s %10s %10s\n", "case", "seconds", "MiB/s");
+  double baselineSeconds = 0.0;
+  for (const auto& benchCase : cases) {
+    qint64 best = 0;
+    for (int i = 0; i < options.repeat; ++i) {
+      QDir outDir(work.absoluteFilePath(QStringLiteral("out")));
+      outDir.removeRecursively();
+      QuaZip zip(archivePath);
+      if (!zip.open(QuaZip::mdUnzip)) {
+        std::fprintf(stderr, "unable to open %s\n", qUtf8Printable(archivePath));
+        return 1;
+      }
+      QElapsedTimer timer;
+      timer.start();
+      const bool ok = benchCase.second(zip, outDir.absolutePath());
+      const qint64 nsecs = timer.nsecsElapsed();
+      zip.close();
+      if (!ok) {
+        std::fprintf(stderr, "%s: extraction failed\n", benchCase.first);
+        return 1;
+      }
+      if (best == 0 || nsecs < best)
+        best = nsecs;
+    }
+    const double seconds = std::max<qint64>(best, 1) / 1e9;
+    if (baselineSeconds == 0.0)
+      baselineSeconds = seconds;
+    std::printf("%-24s %10.2f %10.1f  x%.2f\n", benchCase.first, seconds, mebibytes / seconds,
+                baselineSeconds / seconds);
+  }
+  if (!options.keep)
+    QDir(work.absoluteFilePath(QStringLiteral("out"))).removeRecursively();
+  return 0;
+}
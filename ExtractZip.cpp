@@ -1,25 +1,88 @@
 #include "ExtractZip.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <functional>
+#include <vector>
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDateTime>
 #include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
 #include <quazip.h>
 #include <quazipfile.h>
 
+#if __linux__
+#include <fcntl.h>
+#endif
+
 /**
  * Modified JICompress utilities to operate on in-memory zip.
  * Only contains directory extraction functionality.
  */
 
+static std::atomic<qint64> CopyBufferSize{1024 * 1024};
+
+void ExtractZip::setCopyBufferSize(qint64 size) { CopyBufferSize = std::max<qint64>(size, 4096); }
+
 static bool copyData(QIODevice& inFile, QIODevice& outFile) {
+  // One buffer per thread, shared by every entry that thread extracts
+  thread_local std::vector<char> buf;
+  buf.resize(size_t(CopyBufferSize.load()));
   while (!inFile.atEnd()) {
-    char buf[4096];
-    qint64 readLen = inFile.read(buf, 4096);
+    qint64 readLen = inFile.read(buf.data(), qint64(buf.size()));
     if (readLen <= 0)
       return false;
-    if (outFile.write(buf, readLen) != readLen)
+    if (outFile.write(buf.data(), readLen) != readLen)
       return false;
   }
   return true;
 }
 
+/* Stored entries are written straight out of the mapped archive without passing through a buffer */
+static bool copyStored(QuaZip& zip, const QByteArray& archiveMap, const QuaZipFileInfo64& info, QIODevice& outFile) {
+  const quint64 offset = unzGetCurrentFileZStreamPos64(zip.getUnzFile());
+  if (offset + info.compressedSize > quint64(archiveMap.size()))
+    return false;
+
+  constexpr quint64 ChunkSize = 256 * 1024 * 1024;
+  const char* data = archiveMap.constData() + offset;
+  uLong crc = crc32(0, nullptr, 0);
+  for (quint64 done = 0; done < info.compressedSize;) {
+    const quint64 len = std::min(ChunkSize, info.compressedSize - done);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(data + done), uInt(len));
+    if (outFile.write(data + done, qint64(len)) != qint64(len))
+      return false;
+    done += len;
+  }
+  return crc == info.crc;
+}
+
+static void preallocate(QFile& file, quint64 size) {
+#if __linux__
+  if (size > 0)
+    posix_fallocate(file.handle(), 0, off_t(size));
+#else
+  Q_UNUSED(file)
+  Q_UNUSED(size)
+#endif
+}
+
+/* Maps a file-backed archive so stored entries can be copied without reading through unzip */
+static QByteArray mapArchive(QFile& archive, const QString& zipName) {
+  archive.setFileName(zipName);
+  // QByteArray is int-sized in Qt 5
+  if (zipName.isEmpty() || !archive.open(QIODevice::ReadOnly) || archive.size() >= INT_MAX)
+    return {};
+  const uchar* map = archive.map(0, archive.size());
+  return map ? QByteArray::fromRawData(reinterpret_cast<const char*>(map), int(archive.size())) : QByteArray();
+}
+
 QStringList ExtractZip::getFileList(QuaZip& zip) {
   // Estraggo i nomi dei file
   QStringList lst;
@@ -48,7 +111,7 @@ QStringList ExtractZip::getFileList(QuaZip& zip) {
  *
  * (1): prima di uscire dalla funzione cancella il file estratto.
  */
-bool ExtractZip::extractFile(QuaZip& zip, QString fileName, QString fileDest) {
+bool ExtractZip::extractFile(QuaZip& zip, QString fileName, QString fileDest, const QByteArray& archiveMap) {
   // zip: oggetto dove aggiungere il file
   // filename: nome del file reale
   // fileincompress: nome del file all'interno del file compresso
@@ -94,8 +157,12 @@ bool ExtractZip::extractFile(QuaZip& zip, QString fileName, QString fileDest) {
   if (!outFile.open(QIODevice::WriteOnly))
     return false;
 
+  preallocate(outFile, info.uncompressedSize);
+
   // Copio i dati
-  if (!copyData(inFile, outFile) || inFile.getZipError() != UNZ_OK) {
+  const bool copied = info.method == 0 && !archiveMap.isEmpty() ? copyStored(zip, archiveMap, info, outFile)
+                                                                 : copyData(inFile, outFile);
+  if (!copied || inFile.getZipError() != UNZ_OK) {
     outFile.close();
     return false;
   }
@@ -129,13 +196,243 @@ bool ExtractZip::extractDir(QuaZip& zip, QString dir) {
   if (!zip.goToFirstFile()) {
     return false;
   }
+  QFile archive;
+  const QByteArray archiveMap = mapArchive(archive, zip.getZipName());
   do {
     const QString name = zip.getCurrentFileName();
     const QString absFilePath = directory.absoluteFilePath(name);
-    if (!extractFile(zip, {}, absFilePath)) {
+    if (!extractFile(zip, {}, absFilePath, archiveMap)) {
       return false;
     }
   } while (zip.goToNextFile());
 
   return true;
 }
+
+namespace {
+class FunctionRunnable : public QRunnable {
+  std::function<void()> m_func;
+
+public:
+  explicit FunctionRunnable(std::function<void()>&& func) : m_func(std::move(func)) {}
+  void run() override { m_func(); }
+};
+} // namespace
+
+/**
+ * Parallel variant of extractDir for file-backed archives, limited to entries accepted by select (all if empty).
+ * The central directory is read once on the calling thread; entries are then handed out
+ * (largest first) to a thread pool where each worker owns a QuaZip over the same read-only
+ * mapping of the archive. Falls back to a serial pass when the archive isn't a plain file.
+ * Blocks until every entry is done, so callers on the GUI thread should run it from a worker.
+ */
+static bool extractSelected(QuaZip& zip, const QString& dir, int threadCount, QStringList* errors,
+                            const std::function<bool(const QuaZipFileInfo64& info)>& select) {
+  if (threadCount <= 0)
+    threadCount = QThread::idealThreadCount();
+  const QString zipName = zip.getZipName();
+
+  if (threadCount <= 1 || zipName.isEmpty()) {
+    const QDir directory(dir);
+    QFile archive;
+    const QByteArray archiveMap = mapArchive(archive, zipName);
+    QuaZipFileInfo64 info;
+    for (bool more = zip.goToFirstFile(); more; more = zip.goToNextFile()) {
+      if (!zip.getCurrentFileInfo(&info))
+        return false;
+      if (select && !select(info))
+        continue;
+      const QString absFilePath = directory.absoluteFilePath(info.name);
+      if (!ExtractZip::extractFile(zip, {}, absFilePath, archiveMap)) {
+        if (errors)
+          *errors = QStringList{QCoreApplication::translate("ExtractZip", "Unable to extract %1").arg(absFilePath)};
+        return false;
+      }
+    }
+    return zip.getZipError() == UNZ_OK;
+  }
+
+  struct Entry {
+    unz64_file_pos pos;
+    QString path;
+    quint64 size;
+  };
+  std::vector<Entry> entries;
+  const QDir directory(dir);
+  QuaZipFileInfo64 info;
+  for (bool more = zip.goToFirstFile(); more; more = zip.goToNextFile()) {
+    if (!zip.getCurrentFileInfo(&info))
+      return false;
+    if (select && !select(info))
+      continue;
+    const QString absFilePath = directory.absoluteFilePath(info.name);
+    // Create the tree up front so workers never race on mkpath
+    const bool isDir = absFilePath.endsWith(QLatin1Char{'/'});
+    if (!QDir().mkpath(isDir ? absFilePath : QFileInfo(absFilePath).absolutePath()))
+      return false;
+    Entry entry{{}, absFilePath, info.uncompressedSize};
+    if (unzGetFilePos64(zip.getUnzFile(), &entry.pos) != UNZ_OK)
+      return false;
+    entries.push_back(std::move(entry));
+  }
+  if (entries.empty())
+    return zip.getZipError() == UNZ_OK;
+  std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.size > b.size; });
+
+  // Archives too large to map are opened by name in each worker
+  QFile archive;
+  const QByteArray mapped = mapArchive(archive, zipName);
+
+  std::atomic<size_t> next{0};
+  std::atomic<bool> failed{false};
+  QMutex errorMutex;
+  QStringList errorList;
+  const auto addError = [&](const QString& error) {
+    QMutexLocker locker(&errorMutex);
+    errorList.push_back(error);
+    failed = true;
+  };
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(std::min(threadCount, int(entries.size())));
+  for (int i = 0; i < pool.maxThreadCount(); ++i) {
+    pool.start(new FunctionRunnable([&] {
+      QBuffer buffer;
+      buffer.setData(mapped);
+      QuaZip workerZip;
+      if (!mapped.isEmpty())
+        workerZip.setIoDevice(&buffer);
+      else
+        workerZip.setZipName(zipName);
+      if (!workerZip.open(QuaZip::mdUnzip) || !workerZip.goToFirstFile()) {
+        addError(QCoreApplication::translate("ExtractZip", "Unable to open %1").arg(zipName));
+        return;
+      }
+      for (size_t idx = next++; idx < entries.size() && !failed; idx = next++) {
+        Entry& entry = entries[idx];
+        if (unzGoToFilePos64(workerZip.getUnzFile(), &entry.pos) != UNZ_OK ||
+            !ExtractZip::extractFile(workerZip, {}, entry.path, mapped)) {
+          addError(QCoreApplication::translate("ExtractZip", "Unable to extract %1").arg(entry.path));
+          return;
+        }
+      }
+    }));
+  }
+
+  pool.waitForDone();
+
+  if (errors)
+    *errors = errorList;
+  return errorList.isEmpty();
+}
+
+bool ExtractZip::extractDirParallel(QuaZip& zip, QString dir, int threadCount, QStringList* errors) {
+  return extractSelected(zip, dir, threadCount, errors, {});
+}
+
+/* Manifest of what the last extraction into a directory wrote, used to skip unchanged entries */
+static const QString ManifestName = QStringLiteral(".hecl-gui-extract.json");
+
+static QJsonObject loadManifest(const QDir& directory) {
+  QFile file(directory.absoluteFilePath(ManifestName));
+  if (!file.open(QIODevice::ReadOnly))
+    return {};
+  return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+static bool saveManifest(const QDir& directory, const QJsonObject& manifest) {
+  QSaveFile file(directory.absoluteFilePath(ManifestName));
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+  file.write(QJsonDocument(manifest).toJson(QJsonDocument::Compact));
+  return file.commit();
+}
+
+static QJsonObject manifestEntry(const QuaZipFileInfo64& info, const QFileInfo& onDisk) {
+  QJsonObject entry;
+  entry.insert(QStringLiteral("size"), double(info.uncompressedSize));
+  entry.insert(QStringLiteral("crc"), double(info.crc));
+  entry.insert(QStringLiteral("mtime"), double(onDisk.lastModified().toMSecsSinceEpoch()));
+  return entry;
+}
+
+static bool isUnchanged(const QJsonObject& manifest, const QDir& directory, const QuaZipFileInfo64& info) {
+  const QJsonObject entry = manifest.value(info.name).toObject();
+  if (entry.isEmpty())
+    return false;
+  // A file touched since we wrote it is treated as changed, whatever its content
+  const QFileInfo onDisk(directory.absoluteFilePath(info.name));
+  return onDisk.isFile() && quint64(onDisk.size()) == info.uncompressedSize &&
+         entry == manifestEntry(info, onDisk);
+}
+
+bool ExtractZip::hasManifest(const QString& dir) { return QFileInfo::exists(QDir(dir).absoluteFilePath(ManifestName)); }
+
+/**
+ * Records size, CRC and mtime of every file of zip currently present in dir,
+ * so a later extractDirIncremental can skip them.
+ */
+bool ExtractZip::writeManifest(QuaZip& zip, QString dir) {
+  const QDir directory(dir);
+  QJsonObject manifest;
+  QuaZipFileInfo64 info;
+  for (bool more = zip.goToFirstFile(); more; more = zip.goToNextFile()) {
+    if (!zip.getCurrentFileInfo(&info))
+      return false;
+    const QFileInfo onDisk(directory.absoluteFilePath(info.name));
+    if (!info.name.endsWith(QLatin1Char{'/'}) && onDisk.isFile() && quint64(onDisk.size()) == info.uncompressedSize)
+      manifest.insert(info.name, manifestEntry(info, onDisk));
+  }
+  return saveManifest(directory, manifest);
+}
+
+/**
+ * Like extractDirParallel, but entries whose size and CRC match the manifest of the previous
+ * extraction (and whose file is untouched on disk) are skipped without being inflated.
+ * The names of the entries actually written are returned in rewritten.
+ * Changed entries are written to outDir when given (e.g. a staging directory), otherwise to dir;
+ * the manifest is then only updated by the caller once they are installed.
+ */
+bool ExtractZip::extractDirIncremental(QuaZip& zip, QString dir, QStringList* rewritten, QStringList* errors,
+                                       QString outDir) {
+  const QDir directory(dir);
+  const bool staged = !outDir.isEmpty();
+  QJsonObject manifest = loadManifest(directory);
+  QStringList changed;
+  const bool ok = extractSelected(zip, staged ? outDir : dir, 0, errors, [&](const QuaZipFileInfo64& info) {
+    if (info.name.endsWith(QLatin1Char{'/'}))
+      return true;
+    if (isUnchanged(manifest, directory, info))
+      return false;
+    changed.push_back(info.name);
+    return true;
+  });
+  if (rewritten)
+    *rewritten = changed;
+
+  if (ok)
+    return staged || writeManifest(zip, dir);
+
+  // Anything we tried to write may be partial (and preallocated to full size); forget it
+  for (const QString& name : changed)
+    manifest.remove(name);
+  saveManifest(directory, manifest);
+  return false;
+}
+
+/**
+ * Applies the permissions stored in the central directory to files already
+ * extracted into dir (e.g. by ZipStreamExtractor, which only sees local headers).
+ */
+bool ExtractZip::applyPermissions(QuaZip& zip, QString dir) {
+  const QDir directory(dir);
+  QuaZipFileInfo64 info;
+  for (bool more = zip.goToFirstFile(); more; more = zip.goToNextFile()) {
+    if (!zip.getCurrentFileInfo(&info))
+      return false;
+    const QFile::Permissions srcPerm = info.getPermissions();
+    if (srcPerm != 0 && !QFile::setPermissions(directory.absoluteFilePath(info.name), srcPerm))
+      return false;
+  }
+  return zip.getZipError() == UNZ_OK;
+}
@@ -1,12 +1,20 @@
 #pragma once
 
+#include <QByteArray>
 #include <QStringList>
 class QuaZip;
 class QString;
 
 class ExtractZip {
 public:
+  static void setCopyBufferSize(qint64 size);
   static QStringList getFileList(QuaZip& zip);
-  static bool extractFile(QuaZip& zip, QString fileName, QString fileDest);
+  static bool extractFile(QuaZip& zip, QString fileName, QString fileDest, const QByteArray& archiveMap = {});
   static bool extractDir(QuaZip& zip, QString dir);
+  static bool extractDirParallel(QuaZip& zip, QString dir, int threadCount = 0, QStringList* errors = nullptr);
+  static bool extractDirIncremental(QuaZip& zip, QString dir, QStringList* rewritten = nullptr,
+                                    QStringList* errors = nullptr, QString outDir = {});
+  static bool hasManifest(const QString& dir);
+  static bool writeManifest(QuaZip& zip, QString dir);
+  static bool applyPermissions(QuaZip& zip, QString dir);
 };
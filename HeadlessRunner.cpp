@@ -0,0 +1,409 @@
+#include "HeadlessRunner.hpp"
+
+#include <cstdio>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QJsonDocument>
+#include <QSettings>
+#include <QTimer>
+
+#include "Common.hpp"
+#include "ExtractZip.hpp"
+#include "TerminalParser.hpp"
+
+/* Renders parsed output as plain text; redrawn lines are written out once they are complete */
+class HeadlessRunner::PlainTextSink : public TerminalParser::Sink {
+public:
+  explicit PlainTextSink(QFile& out) : m_out(out) {}
+
+  void setEnabled(bool enabled) { m_enabled = enabled; }
+
+  void text(const QChar* data, int len, int) override { m_line.append(data, len); }
+  void carriageReturn() override { m_line.clear(); }
+  void lineFeed() override {
+    if (m_enabled) {
+      m_line.append(QLatin1Char{'\n'});
+      m_out.write(m_line.toUtf8());
+      m_out.flush();
+    }
+    m_line.clear();
+  }
+  void cursorUp(int) override {}
+
+  // Writes out a trailing line that never received its line feed
+  void finish() {
+    if (!m_line.isEmpty())
+      lineFeed();
+  }
+
+private:
+  QFile& m_out;
+  QString m_line;
+  bool m_enabled = true;
+};
+
+namespace {
+constexpr qint64 ProgressIntervalMsec = 500;
+
+QString StageName(StagePipeline::Stage stage) {
+  switch (stage) {
+  case StagePipeline::Stage::Extract:
+    return QStringLiteral("extract");
+  case StagePipeline::Stage::Package:
+    return QStringLiteral("package");
+  case StagePipeline::Stage::Launch:
+  default:
+    return QStringLiteral("launch");
+  }
+}
+} // namespace
+
+int HeadlessRunner::exec(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      QCoreApplication::translate("HeadlessRunner", "Downloads binaries, extracts and packages without a window."));
+  parser.addHelpOption();
+  const QCommandLineOption headlessOption(QStringLiteral("headless"),
+                                          QCoreApplication::translate("HeadlessRunner", "Run without a window."));
+  const QCommandLineOption dirOption(QStringLiteral("dir"),
+                                     QCoreApplication::translate("HeadlessRunner", "Working directory."),
+                                     QStringLiteral("path"));
+  const QCommandLineOption imageOption(QStringLiteral("image"),
+                                       QCoreApplication::translate("HeadlessRunner", "Disc image to extract from."),
+                                       QStringLiteral("path"));
+  const QCommandLineOption downloadOption(
+      QStringLiteral("download"),
+      QCoreApplication::translate("HeadlessRunner", "Download binaries even if usable ones are present."));
+  const QCommandLineOption versionOption(
+      QStringLiteral("version"),
+      QCoreApplication::translate("HeadlessRunner", "Release to download instead of the newest one."),
+      QStringLiteral("name"));
+  const QCommandLineOption trackOption(QStringLiteral("track"),
+                                       QCoreApplication::translate("HeadlessRunner", "Release track to download from."),
+                                       QStringLiteral("track"));
+  const QCommandLineOption colorOption(
+      QStringLiteral("color"),
+      QCoreApplication::translate("HeadlessRunner", "Pass escape sequences in process output through to stderr."));
+  const QCommandLineOption noLogsOption(QStringLiteral("no-session-logs"),
+                                        QCoreApplication::translate("HeadlessRunner", "Don't record session logs."));
+  parser.addOptions({headlessOption, dirOption, imageOption, downloadOption, versionOption, trackOption, colorOption,
+                     noLogsOption});
+
+  if (!parser.parse(QCoreApplication::arguments())) {
+    std::fprintf(stderr, "%s\n", qUtf8Printable(parser.errorText()));
+    return UsageError;
+  }
+  if (parser.isSet(QStringLiteral("help"))) {
+    std::fprintf(stdout, "%s", qUtf8Printable(parser.helpText()));
+    return Success;
+  }
+  if (!parser.isSet(dirOption)) {
+    std::fprintf(stderr, "%s\n",
+                 qUtf8Printable(QCoreApplication::translate("HeadlessRunner", "--dir is required with --headless")));
+    return UsageError;
+  }
+
+  Options options;
+  options.workingDir = QDir(parser.value(dirOption)).absolutePath();
+  if (parser.isSet(imageOption))
+    options.imagePath = QDir(parser.value(imageOption)).absolutePath();
+  options.track = parser.value(trackOption);
+  options.version = parser.value(versionOption);
+  options.download = parser.isSet(downloadOption);
+  options.ansi = parser.isSet(colorOption);
+  options.sessionLogs = !parser.isSet(noLogsOption) &&
+                        QSettings().value(QStringLiteral("session_logs"), true).toBool();
+
+  HeadlessRunner runner(options);
+  connect(&runner, &HeadlessRunner::finished, &app, &QCoreApplication::exit, Qt::QueuedConnection);
+  QTimer::singleShot(0, &runner, &HeadlessRunner::start);
+  return QCoreApplication::exec();
+}
+
+HeadlessRunner::HeadlessRunner(const Options& options, QObject* parent)
+: QObject(parent)
+, m_options(options)
+, m_dlManager(this)
+, m_binaryProbe(this)
+, m_jobs(this)
+, m_packageState(this)
+, m_pipeline(m_jobs, m_packageState, this)
+, m_outputPump(this)
+, m_progressModel(this)
+, m_progressFilter(m_progressModel)
+, m_console(std::make_unique<PlainTextSink>(m_stderr)) {
+  m_stdout.open(stdout, QIODevice::WriteOnly);
+  m_stderr.open(stderr, QIODevice::WriteOnly);
+
+  m_dlManager.setTrack(m_options.track);
+  // There's no browser to hand the release page to, whatever the GUI does on this platform
+  m_dlManager.setZipDownload(true);
+  m_dlManager.connectWidgets(nullptr, nullptr,
+                             std::bind(&HeadlessRunner::onIndexDownloaded, this, std::placeholders::_1),
+                             std::bind(&HeadlessRunner::onBinaryDownloaded, this, std::placeholders::_1,
+                                       std::placeholders::_2),
+                             [this]() { onDownloadError(tr("Download failed")); });
+  connect(&m_dlManager, &DownloadManager::errorOccurred, this, &HeadlessRunner::onDownloadError);
+  connect(&m_dlManager, &DownloadManager::binaryProgress, this, [this](qint64 received, qint64 total) {
+    if (m_progressTimer.isValid() && m_progressTimer.elapsed() < ProgressIntervalMsec && received != total)
+      return;
+    m_progressTimer.start();
+    report({{QStringLiteral("event"), QStringLiteral("progress")},
+            {QStringLiteral("stage"), m_stage},
+            {QStringLiteral("done"), received},
+            {QStringLiteral("total"), total},
+            {QStringLiteral("fraction"), total > 0 ? double(received) / double(total) : -1.0}});
+  });
+  connect(&m_binaryProbe, &BinaryVersionProbe::probed, this, &HeadlessRunner::onBinariesProbed);
+
+  // With --color the raw stream goes to stderr and the parsed one only drives progress
+  m_console->setEnabled(!m_options.ansi);
+  m_progressFilter.setDownstream(m_console.get());
+  m_outputPump.setSink(&m_progressFilter);
+  m_outputPump.setFlushHandler([this] { onConsoleOutput(); });
+  m_outputPump.setInputTap([this](const char* data, qint64 len) {
+    m_sessionLog.append(data, len);
+    if (m_options.ansi) {
+      m_stderr.write(data, len);
+      m_stderr.flush();
+    }
+  });
+  connect(&m_progressModel, &ConsoleProgressModel::changed, this, &HeadlessRunner::onProgress);
+  connect(&m_jobs, &JobRunner::jobOutput, this, [this](JobId id, QIODevice* output) {
+    if (id == m_job)
+      m_outputPump.appendFrom(*output);
+  });
+  connect(&m_jobs, &JobRunner::jobFinished, this, &HeadlessRunner::onJobFinished);
+  connect(&m_pipeline, &StagePipeline::stageSkipped, this, [this](StagePipeline::Stage stage) {
+    report({{QStringLiteral("event"), QStringLiteral("stage")},
+            {QStringLiteral("stage"), StageName(stage)},
+            {QStringLiteral("state"), QStringLiteral("skipped")}});
+  });
+  connect(&m_pipeline, &StagePipeline::stageStarted, this, &HeadlessRunner::onStageStarted);
+  connect(&m_pipeline, &StagePipeline::finished, this, &HeadlessRunner::onPipelineFinished);
+}
+
+HeadlessRunner::~HeadlessRunner() = default;
+
+void HeadlessRunner::start() {
+  if (!QDir().mkpath(m_options.workingDir)) {
+    finish(UsageError, tr("Unable to create working directory %1").arg(m_options.workingDir));
+    return;
+  }
+  m_packageState.setPath(m_options.workingDir);
+  report({{QStringLiteral("event"), QStringLiteral("start")},
+          {QStringLiteral("workingDir"), m_options.workingDir},
+          {QStringLiteral("platform"), CurPlatformString},
+          {QStringLiteral("architecture"), CurArchitectureString}});
+  probeBinaries();
+}
+
+void HeadlessRunner::beginStage(const QString& stage) {
+  m_stage = stage;
+  m_stageTimer.start();
+  m_progressTimer.invalidate();
+  m_progressPhase.clear();
+  report({{QStringLiteral("event"), QStringLiteral("stage")},
+          {QStringLiteral("stage"), stage},
+          {QStringLiteral("state"), QStringLiteral("started")}});
+}
+
+void HeadlessRunner::endStage(const QString& stage, QJsonObject&& details) {
+  details.insert(QStringLiteral("event"), QStringLiteral("stage"));
+  details.insert(QStringLiteral("stage"), stage);
+  if (!details.contains(QStringLiteral("state")))
+    details.insert(QStringLiteral("state"), QStringLiteral("finished"));
+  details.insert(QStringLiteral("elapsedMsec"), m_stageTimer.isValid() ? m_stageTimer.elapsed() : 0);
+  report(std::move(details));
+}
+
+void HeadlessRunner::report(QJsonObject&& event) {
+  m_stdout.write(QJsonDocument(event).toJson(QJsonDocument::Compact));
+  m_stdout.write("\n", 1);
+  m_stdout.flush();
+}
+
+void HeadlessRunner::finish(ExitCode code, const QString& message) {
+  if (m_finished)
+    return;
+  m_finished = true;
+  if (!message.isEmpty()) {
+    m_stderr.write(message.toUtf8());
+    m_stderr.write("\n", 1);
+    m_stderr.flush();
+  }
+  report({{QStringLiteral("event"), QStringLiteral("finished")},
+          {QStringLiteral("success"), code == Success},
+          {QStringLiteral("exitCode"), int(code)},
+          {QStringLiteral("message"), message}});
+  emit finished(code);
+}
+
+void HeadlessRunner::probeBinaries() {
+  beginStage(QStringLiteral("binaries"));
+  m_binaryProbe.probe(BinaryVersionProbe::binaryPaths(m_options.workingDir));
+}
+
+void HeadlessRunner::onBinariesProbed(const QVector<BinaryVersionProbe::Result>& results) {
+  if (m_finished)
+    return;
+  // urde, hecl, visigen; only hecl is needed to extract and package
+  const BinaryVersionProbe::Result& urde = results.value(0);
+  const BinaryVersionProbe::Result& hecl = results.value(1);
+  endStage(QStringLiteral("binaries"), {{QStringLiteral("hecl"), hecl.found ? hecl.path : QString()},
+                                        {QStringLiteral("urde"), urde.found ? urde.path : QString()},
+                                        {QStringLiteral("version"), hecl.dlPackage}});
+
+  if (hecl.found && (!m_options.download || m_downloaded)) {
+    m_heclPath = hecl.path;
+    m_urdePath = urde.path;
+    startPipeline();
+    return;
+  }
+  if (m_downloaded) {
+    finish(BinariesMissing, tr("Downloaded hecl in %1 could not be started").arg(m_options.workingDir));
+    return;
+  }
+
+  beginStage(QStringLiteral("index"));
+  m_dlManager.fetchIndex();
+}
+
+void HeadlessRunner::onIndexDownloaded(const QStringList& index) {
+  if (m_finished)
+    return;
+  endStage(QStringLiteral("index"), {{QStringLiteral("releases"), index.size()}});
+
+  URDEVersion chosen;
+  for (const QString& str : index) {
+    const URDEVersion version(str);
+    if (m_options.version.isEmpty() || version.fileString(false) == m_options.version) {
+      chosen = version;
+      break;
+    }
+  }
+  if (!chosen.isValid()) {
+    finish(DownloadFailed, m_options.version.isEmpty() ? tr("No releases available")
+                                                       : tr("Release %1 not found").arg(m_options.version));
+    return;
+  }
+
+  const QString filename = chosen.fileString(true);
+  beginStage(QStringLiteral("download"));
+  report({{QStringLiteral("event"), QStringLiteral("download")}, {QStringLiteral("file"), filename}});
+  m_stagedInstall = std::make_unique<StagedInstall>(m_options.workingDir);
+  const QString streamExtractDir =
+      ExtractZip::hasManifest(m_options.workingDir) ? QString() : m_stagedInstall->stagingDir();
+  m_dlManager.fetchBinary(filename, m_options.workingDir + QLatin1Char{'/'} + filename, streamExtractDir);
+}
+
+void HeadlessRunner::onBinaryDownloaded(const QString& archivePath, bool extracted) {
+  if (m_finished) {
+    // The archive was handed over to be installed; nobody else removes it
+    QFile::remove(archivePath);
+    return;
+  }
+  m_stagedInstall->commitArchiveAsync(
+      archivePath, extracted, this,
+      [this, extracted](bool ok, const QStringList& rewritten, const QString& installError) {
+        onBinaryInstalled(ok, extracted, rewritten, installError);
+      });
+}
+
+void HeadlessRunner::onBinaryInstalled(bool ok, bool extracted, const QStringList& rewritten,
+                                       const QString& installError) {
+  m_stagedInstall.reset();
+  if (m_finished)
+    return;
+  if (!ok) {
+    finish(DownloadFailed, installError.isEmpty() ? tr("Error extracting zip") : installError);
+    return;
+  }
+
+  endStage(QStringLiteral("download"),
+           {{QStringLiteral("updatedFiles"), QJsonValue(extracted ? -1 : rewritten.size())}});
+  m_downloaded = true;
+  probeBinaries();
+}
+
+void HeadlessRunner::onDownloadError(const QString& message) {
+  if (m_finished)
+    return;
+  m_stagedInstall.reset();
+  endStage(m_stage, {{QStringLiteral("state"), QStringLiteral("failed")}, {QStringLiteral("message"), message}});
+  finish(DownloadFailed, message);
+}
+
+void HeadlessRunner::startPipeline() {
+  StagePipeline::Config config;
+  config.workingDir = m_options.workingDir;
+  config.heclPath = m_heclPath;
+  config.urdePath = m_urdePath;
+  config.imagePath = m_options.imagePath;
+  config.launch = false;
+  m_stage.clear();
+  m_pipeline.start(config);
+}
+
+void HeadlessRunner::onStageStarted(StagePipeline::Stage stage, JobId job) {
+  m_job = job;
+  beginStage(StageName(stage));
+  if (m_options.sessionLogs) {
+    const JobSpec* spec = m_jobs.spec(job);
+    m_sessionLog.begin(m_options.workingDir, spec ? spec->name : m_stage);
+  }
+  m_outputPump.clear();
+  m_progressFilter.reset();
+  m_progressModel.reset();
+}
+
+void HeadlessRunner::onJobFinished(JobId id, const JobResult& result) {
+  if (id != m_job)
+    return;
+  m_job = 0;
+  m_outputPump.drain();
+  m_progressFilter.finish();
+  m_console->finish();
+  m_progressModel.reset();
+  m_sessionLog.end();
+  const QString state = result.succeeded() ? QStringLiteral("finished") : QStringLiteral("failed");
+  endStage(m_stage, {{QStringLiteral("state"), state}, {QStringLiteral("exitCode"), result.exitCode}});
+}
+
+void HeadlessRunner::onPipelineFinished(bool success, const QString& message) {
+  if (success)
+    finish(Success, message);
+  else if (m_stage == QStringLiteral("package"))
+    finish(PackageFailed, message);
+  else if (m_stage == QStringLiteral("extract"))
+    finish(ExtractFailed, message);
+  else
+    finish(UsageError, message); // nothing ran, e.g. extraction is needed but no image was given
+}
+
+void HeadlessRunner::onConsoleOutput() {
+  m_progressFilter.flushPending();
+  m_progressModel.publish();
+}
+
+void HeadlessRunner::onProgress(const ConsoleProgress& progress) {
+  if (!progress.active)
+    return;
+  if (progress.phase == m_progressPhase && m_progressTimer.isValid() &&
+      m_progressTimer.elapsed() < ProgressIntervalMsec && progress.fraction < 1.0)
+    return;
+  m_progressPhase = progress.phase;
+  m_progressTimer.start();
+  report({{QStringLiteral("event"), QStringLiteral("progress")},
+          {QStringLiteral("stage"), m_stage},
+          {QStringLiteral("phase"), progress.phase},
+          {QStringLiteral("item"), progress.item},
+          {QStringLiteral("done"), progress.done},
+          {QStringLiteral("total"), progress.total},
+          {QStringLiteral("fraction"), progress.fraction},
+          {QStringLiteral("etaMsec"), progress.etaMsec}});
+}
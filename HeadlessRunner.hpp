@@ -0,0 +1,109 @@
+#pragma once
+
+#include <memory>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonObject>
+#include <QObject>
+#include <QVector>
+
+#include "BinaryVersionProbe.hpp"
+#include "ConsoleOutputPump.hpp"
+#include "ConsoleProgress.hpp"
+#include "DownloadManager.hpp"
+#include "JobRunner.hpp"
+#include "PackageStateTracker.hpp"
+#include "ProgressRecognizer.hpp"
+#include "SessionLog.hpp"
+#include "StagePipeline.hpp"
+#include "StagedInstall.hpp"
+
+/**
+ * Runs download, extract and package without widgets, for `hecl-gui --headless`.
+ * Binaries are probed as in the GUI and only fetched from the release index when missing (or
+ * when asked to); extract and package go through StagePipeline, so complete stages are skipped.
+ * Process output is written to stderr, either with its escape sequences intact or rendered as
+ * plain text. Every state change is reported on stdout as one JSON object per line, and the
+ * process exits with one of the ExitCode values.
+ */
+class HeadlessRunner : public QObject {
+  Q_OBJECT
+
+public:
+  enum ExitCode {
+    Success = 0,
+    UsageError = 1,
+    DownloadFailed = 2,
+    BinariesMissing = 3,
+    ExtractFailed = 4,
+    PackageFailed = 5,
+  };
+
+  struct Options {
+    QString workingDir;
+    QString imagePath;
+    QString track;   // empty for the update_track setting
+    QString version; // release file name without extension; empty for the newest
+    bool download = false;
+    bool ansi = false;
+    bool sessionLogs = true;
+  };
+
+  // Creates the QCoreApplication, runs to completion and returns the process exit code
+  static int exec(int argc, char* argv[]);
+
+  explicit HeadlessRunner(const Options& options, QObject* parent = Q_NULLPTR);
+  ~HeadlessRunner() override;
+
+  void start();
+
+signals:
+  void finished(int exitCode);
+
+private:
+  class PlainTextSink;
+
+  void beginStage(const QString& stage);
+  void endStage(const QString& stage, QJsonObject&& details = {});
+  void report(QJsonObject&& event);
+  void finish(ExitCode code, const QString& message = {});
+
+  void probeBinaries();
+  void onBinariesProbed(const QVector<BinaryVersionProbe::Result>& results);
+  void onIndexDownloaded(const QStringList& index);
+  void onBinaryDownloaded(const QString& archivePath, bool extracted);
+  void onBinaryInstalled(bool ok, bool extracted, const QStringList& rewritten, const QString& installError);
+  void onDownloadError(const QString& message);
+  void startPipeline();
+  void onStageStarted(StagePipeline::Stage stage, JobId job);
+  void onJobFinished(JobId id, const JobResult& result);
+  void onPipelineFinished(bool success, const QString& message);
+  void onConsoleOutput();
+  void onProgress(const ConsoleProgress& progress);
+
+  Options m_options;
+  QFile m_stdout;
+  QFile m_stderr;
+  DownloadManager m_dlManager;
+  BinaryVersionProbe m_binaryProbe;
+  JobRunner m_jobs;
+  PackageStateTracker m_packageState;
+  StagePipeline m_pipeline;
+  ConsoleOutputPump m_outputPump;
+  ConsoleProgressModel m_progressModel;
+  ProgressRecognizer m_progressFilter;
+  std::unique_ptr<PlainTextSink> m_console;
+  SessionLog m_sessionLog;
+  std::unique_ptr<StagedInstall> m_stagedInstall;
+
+  QString m_heclPath;
+  QString m_urdePath;
+  QString m_stage;
+  QElapsedTimer m_stageTimer;
+  QElapsedTimer m_progressTimer;
+  QString m_progressPhase;
+  JobId m_job = 0;
+  bool m_downloaded = false;
+  bool m_finished = false;
+};
@@ -0,0 +1,170 @@
+#include "JobRunner.hpp"
+
+#include <vector>
+
+#include <QDateTime>
+
+#if _WIN32
+#include <Windows.h>
+#include <shellapi.h>
+#include <TlHelp32.h>
+
+static void KillProcessTree(QProcess& proc) {
+  quint64 pid = proc.processId();
+  if (pid == 0) {
+    return;
+  }
+
+  PROCESSENTRY32 pe = {};
+  pe.dwSize = sizeof(PROCESSENTRY32);
+
+  HANDLE hSnap = ::CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+
+  if (::Process32First(hSnap, &pe) == TRUE) {
+    BOOL bContinue = TRUE;
+
+    // kill child processes
+    while (bContinue != FALSE) {
+      // only kill child processes
+      if (pe.th32ParentProcessID == pid) {
+        HANDLE hChildProc = ::OpenProcess(PROCESS_ALL_ACCESS, FALSE, pe.th32ProcessID);
+
+        if (hChildProc) {
+          ::TerminateProcess(hChildProc, 1);
+          ::CloseHandle(hChildProc);
+        }
+      }
+
+      bContinue = ::Process32Next(hSnap, &pe);
+    }
+  }
+
+  proc.close();
+  proc.terminate();
+}
+#else
+static void KillProcessTree(QProcess& proc) {
+  proc.close();
+  proc.terminate();
+}
+#endif
+
+JobRunner::JobRunner(QObject* parent) : QObject(parent) {}
+
+JobRunner::~JobRunner() {
+  for (auto& entry : m_jobs) {
+    entry.second.process->disconnect(this);
+    KillProcessTree(*entry.second.process);
+  }
+}
+
+QProcessEnvironment JobRunner::terminalEnvironment() {
+  QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+  env.insert(QStringLiteral("TERM"), QStringLiteral("xterm-color"));
+  env.insert(QStringLiteral("ConEmuANSI"), QStringLiteral("ON"));
+  return env;
+}
+
+JobId JobRunner::start(const JobSpec& spec) {
+  const JobId id = m_nextId++;
+  auto* proc = new QProcess(this);
+  proc->setProcessChannelMode(QProcess::ProcessChannelMode::MergedChannels);
+  proc->setWorkingDirectory(spec.workingDir);
+  proc->setProcessEnvironment(spec.environment.isEmpty() ? terminalEnvironment() : spec.environment);
+
+  Job& job = m_jobs[id];
+  job.spec = spec;
+  job.process = proc;
+
+  connect(proc, &QProcess::readyRead, this, [this, id, proc] { emit jobOutput(id, proc); });
+  connect(proc, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this,
+          [this, id](int exitCode, QProcess::ExitStatus status) {
+            finish(id, status == QProcess::CrashExit ? JobResult::State::Crashed : JobResult::State::Finished,
+                   exitCode);
+          });
+  // Queued so a job that fails right away still ends after start() has returned its id
+  connect(
+      proc, &QProcess::errorOccurred, this,
+      [this, id](QProcess::ProcessError error) {
+        // Other errors are followed by finished()
+        if (error == QProcess::FailedToStart)
+          finish(id, JobResult::State::FailedToStart, -1);
+      },
+      Qt::QueuedConnection);
+
+  job.startedAt = QDateTime::currentMSecsSinceEpoch();
+  job.timer.start();
+  emit jobStarted(id, spec);
+  proc->start(spec.program, spec.arguments, QIODevice::ReadOnly | QIODevice::Unbuffered);
+  return id;
+}
+
+void JobRunner::cancel(JobId id) {
+  const auto it = m_jobs.find(id);
+  if (it == m_jobs.end())
+    return;
+  it->second.cancelled = true;
+  KillProcessTree(*it->second.process);
+  // Normally reported by finished() while killing; make sure the job ends either way
+  finish(id, JobResult::State::Cancelled, -1);
+}
+
+void JobRunner::cancelAll() {
+  std::vector<JobId> ids;
+  ids.reserve(m_jobs.size());
+  for (const auto& entry : m_jobs)
+    ids.push_back(entry.first);
+  for (JobId id : ids)
+    cancel(id);
+}
+
+QProcess* JobRunner::process(JobId id) const {
+  const auto it = m_jobs.find(id);
+  return it != m_jobs.end() ? it->second.process : nullptr;
+}
+
+QVector<qint64> JobRunner::processIds() const {
+  QVector<qint64> pids;
+  for (const auto& entry : m_jobs) {
+    if (const qint64 pid = entry.second.process->processId())
+      pids.push_back(pid);
+  }
+  return pids;
+}
+
+const JobSpec* JobRunner::spec(JobId id) const {
+  const auto it = m_jobs.find(id);
+  return it != m_jobs.end() ? &it->second.spec : nullptr;
+}
+
+qint64 JobRunner::elapsedMsec(JobId id) const {
+  const auto it = m_jobs.find(id);
+  return it != m_jobs.end() ? it->second.timer.elapsed() : -1;
+}
+
+void JobRunner::finish(JobId id, JobResult::State state, int exitCode) {
+  auto it = m_jobs.find(id);
+  if (it == m_jobs.end())
+    return;
+  // Output that arrived after the last readyRead() is handed out while the job still exists
+  if (it->second.process->bytesAvailable() > 0) {
+    emit jobOutput(id, it->second.process);
+    it = m_jobs.find(id);
+    if (it == m_jobs.end())
+      return;
+  }
+  Job job = std::move(it->second);
+  m_jobs.erase(it);
+
+  JobResult result;
+  result.spec = std::move(job.spec);
+  result.state = job.cancelled ? JobResult::State::Cancelled : state;
+  result.exitCode = exitCode;
+  result.startedAt = job.startedAt;
+  result.elapsedMsec = job.timer.elapsed();
+
+  // Receivers may still read the remaining output; the process goes away once they're done
+  job.process->disconnect(this);
+  job.process->deleteLater();
+  emit jobFinished(id, result);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <map>
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QProcess>
+#include <QStringList>
+#include <QVector>
+
+class QIODevice;
+
+using JobId = quint64;
+
+enum class JobKind { Extract, Package, Launch, Other };
+
+struct JobSpec {
+  JobKind kind = JobKind::Other;
+  QString name; // short label, e.g. for session logs
+  QString program;
+  QStringList arguments;
+  QString workingDir;
+  // Empty means JobRunner::terminalEnvironment()
+  QProcessEnvironment environment;
+};
+
+struct JobResult {
+  enum class State { Finished, Crashed, FailedToStart, Cancelled };
+
+  JobSpec spec;
+  State state = State::Finished;
+  int exitCode = -1;
+  qint64 startedAt = 0; // msecs since epoch
+  qint64 elapsedMsec = 0;
+
+  bool succeeded() const { return state == State::Finished && exitCode == 0; }
+};
+
+/**
+ * Owns the child processes started on behalf of the GUI, any number at a time.
+ * Each job gets its own QProcess with stdout and stderr merged; jobOutput() hands out that
+ * stream whenever new bytes arrive, a last time just before jobFinished() if any are left.
+ * Every started job ends with exactly one jobFinished(), including jobs that failed to start
+ * or were cancelled, after which its id is no longer valid.
+ * Cancelling a job kills its whole process tree.
+ */
+class JobRunner : public QObject {
+  Q_OBJECT
+
+public:
+  explicit JobRunner(QObject* parent = Q_NULLPTR);
+  // Kills whatever is still running without reporting it
+  ~JobRunner() override;
+
+  // The system environment with ANSI color output enabled
+  static QProcessEnvironment terminalEnvironment();
+
+  JobId start(const JobSpec& spec);
+  void cancel(JobId id);
+  void cancelAll();
+
+  bool isRunning(JobId id) const { return m_jobs.count(id) != 0; }
+  int runningCount() const { return int(m_jobs.size()); }
+  // Null once the job has finished
+  QProcess* process(JobId id) const;
+  const JobSpec* spec(JobId id) const;
+  // Of every job whose process is currently running
+  QVector<qint64> processIds() const;
+  qint64 elapsedMsec(JobId id) const;
+
+signals:
+  void jobStarted(JobId id, const JobSpec& spec);
+  void jobOutput(JobId id, QIODevice* output);
+  void jobFinished(JobId id, const JobResult& result);
+
+private:
+  struct Job {
+    JobSpec spec;
+    QProcess* process = nullptr;
+    QElapsedTimer timer;
+    qint64 startedAt = 0;
+    bool cancelled = false;
+  };
+
+  void finish(JobId id, JobResult::State state, int exitCode);
+
+  std::map<JobId, Job> m_jobs;
+  JobId m_nextId = 1;
+};
@@ -1,63 +1,21 @@
 #include "MainWindow.hpp"
+
+#include <algorithm>
+#include <utility>
+
 #include "ui_MainWindow.h"
 #include "LayerDialog.hpp"
 
 #include <QFontDatabase>
+#include <QDockWidget>
 #include <QMessageBox>
+#include <QThread>
 #include <QComboBox>
 #include <QLabel>
 #include <QTreeView>
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-#include <QtCore5Compat>
-#endif
-#include "EscapeSequenceParser.hpp"
 #include "FileDirDialog.hpp"
 #include "ExtractZip.hpp"
-
-#if _WIN32
-#include <Windows.h>
-#include <shellapi.h>
-#include <TlHelp32.h>
-
-static void KillProcessTree(QProcess& proc) {
-  quint64 pid = proc.processId();
-  if (pid == 0) {
-    return;
-  }
-
-  PROCESSENTRY32 pe = {};
-  pe.dwSize = sizeof(PROCESSENTRY32);
-
-  HANDLE hSnap = ::CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-
-  if (::Process32First(hSnap, &pe) == TRUE) {
-    BOOL bContinue = TRUE;
-
-    // kill child processes
-    while (bContinue != FALSE) {
-      // only kill child processes
-      if (pe.th32ParentProcessID == pid) {
-        HANDLE hChildProc = ::OpenProcess(PROCESS_ALL_ACCESS, FALSE, pe.th32ProcessID);
-
-        if (hChildProc) {
-          ::TerminateProcess(hChildProc, 1);
-          ::CloseHandle(hChildProc);
-        }
-      }
-
-      bContinue = ::Process32Next(hSnap, &pe);
-    }
-  }
-
-  proc.close();
-  proc.terminate();
-}
-#else
-static void KillProcessTree(QProcess& proc) {
-  proc.close();
-  proc.terminate();
-}
-#endif
+#include "ProcessMonitorWidget.hpp"
 
 const QStringList MainWindow::skUpdateTracks = {QStringLiteral("stable"), QStringLiteral("dev"), QStringLiteral("continuous")};
 
@@ -67,8 +25,16 @@ MainWindow::MainWindow(QWidget* parent)
 , m_fileMgr(_SYS_STR("urde"))
 , m_cvarManager(m_fileMgr)
 , m_cvarCommons(m_cvarManager)
-, m_heclProc(this)
-, m_dlManager(this) {
+, m_jobs(this)
+, m_outputPump(this)
+, m_progressModel(this)
+, m_progressFilter(m_progressModel)
+, m_dlManager(this)
+, m_binaryProbe(this)
+, m_packageState(this)
+, m_pipeline(m_jobs, m_packageState, this)
+, m_shardedPackager(m_jobs, m_progressModel, this)
+, m_processMonitor(this) {
   if (m_settings.value(QStringLiteral("urde_arguments")).isNull()) {
     m_settings.setValue(QStringLiteral("urde_arguments"), QStringList{QStringLiteral("--no-shader-warmup")});
   }
@@ -87,7 +53,22 @@ MainWindow::MainWindow(QWidget* parent)
   m_ui->recommendedBinaryLabel->setFont(mFont);
   mFont.setPointSize(10);
   m_ui->processOutput->setFont(mFont);
-  m_cursor = QTextCursor(m_ui->processOutput->document());
+  constexpr qint64 MiB = 1024 * 1024;
+  m_ui->processOutput->log().setCapacity(
+      m_settings.value(QStringLiteral("console_scrollback_mb"), ConsoleLog::DefaultCapacity / MiB).toLongLong() * MiB,
+      m_settings.value(QStringLiteral("console_spill_mb"), ConsoleLog::DefaultSpillCapacity / MiB).toLongLong() * MiB);
+  m_ui->processOutput->setFormats(&m_outputPump.formats());
+  m_progressFilter.setDownstream(&m_ui->processOutput->log());
+  connect(&m_progressModel, &ConsoleProgressModel::changed, m_ui->consoleProgress,
+          &ConsoleProgressWidget::setProgress);
+
+  m_processMonitor.setRootProvider([this] { return m_jobs.processIds(); });
+  auto* resourcesDock = new QDockWidget(tr("Resources"), this);
+  resourcesDock->setObjectName(QStringLiteral("resourcesDock"));
+  resourcesDock->setWidget(new ProcessMonitorWidget(m_processMonitor, resourcesDock));
+  addDockWidget(Qt::BottomDockWidgetArea, resourcesDock);
+  resourcesDock->hide();
+  m_ui->resourcesButton->setDefaultAction(resourcesDock->toggleViewAction());
   connect(m_ui->saveLogButton, &QPushButton::pressed, this, [this] {
     QString defaultFileName = QStringLiteral("urde-") + QDateTime::currentDateTime().toString(Qt::DateFormat::ISODate) +
                               QStringLiteral(".log");
@@ -99,9 +80,9 @@ MainWindow::MainWindow(QWidget* parent)
     }
     QFile file = QFile(fileName);
     if (file.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate | QFile::OpenModeFlag::Text)) {
-      QTextStream stream(&file);
-      stream << m_ui->processOutput->toPlainText();
-      stream.flush();
+      m_outputPump.drain();
+      if (!m_ui->processOutput->log().saveTo(file))
+        QMessageBox::critical(this, tr("Save Log"), tr("Failed to write log file"));
       file.close();
     } else {
       QMessageBox::critical(this, tr("Save Log"), tr("Failed to open log file"));
@@ -118,11 +99,11 @@ MainWindow::MainWindow(QWidget* parent)
 
   m_dlManager.connectWidgets(m_ui->downloadProgressBar, m_ui->downloadErrorLabel,
                              std::bind(&MainWindow::onIndexDownloaded, this, std::placeholders::_1),
-                             std::bind(&MainWindow::onBinaryDownloaded, this, std::placeholders::_1),
+                             std::bind(&MainWindow::onBinaryDownloaded, this, std::placeholders::_1,
+                                       std::placeholders::_2),
                              std::bind(&MainWindow::onBinaryFailed, this));
-#if !PLATFORM_ZIP_DOWNLOAD
-  m_ui->downloadProgressBar->hide();
-#endif
+  if (!m_dlManager.zipDownload())
+    m_ui->downloadProgressBar->hide();
 
   initOptions();
   initSlots();
@@ -133,7 +114,7 @@ MainWindow::MainWindow(QWidget* parent)
   resize(1024, 768);
 }
 
-MainWindow::~MainWindow() { KillProcessTree(m_heclProc); }
+MainWindow::~MainWindow() = default;
 
 void MainWindow::onExtract() {
   if (m_path.isEmpty()) {
@@ -146,20 +127,7 @@ void MainWindow::onExtract() {
     return;
   }
 
-  m_ui->processOutput->clear();
-  KillProcessTree(m_heclProc);
-  m_heclProc.setProcessChannelMode(QProcess::ProcessChannelMode::MergedChannels);
-  m_heclProc.setWorkingDirectory(m_path);
-  QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-  env.insert(QStringLiteral("TERM"), QStringLiteral("xterm-color"));
-  env.insert(QStringLiteral("ConEmuANSI"), QStringLiteral("ON"));
-  m_heclProc.setProcessEnvironment(env);
-  disconnect(&m_heclProc, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), nullptr, nullptr);
-  connect(&m_heclProc, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, &MainWindow::onExtractFinished);
-
-  const QStringList heclProcArguments{
-      QStringLiteral("extract"), QStringLiteral("-y"), QStringLiteral("-g"), QStringLiteral("-o"), m_path, imgPath};
-  m_heclProc.start(m_heclPath, heclProcArguments, QIODevice::ReadOnly | QIODevice::Unbuffered);
+  startConsoleJob(StagePipeline::extractJob(m_path, m_heclPath, imgPath));
 
   m_ui->heclTabs->setCurrentIndex(0);
 
@@ -171,30 +139,20 @@ void MainWindow::onExtract() {
 }
 
 void MainWindow::onExtractFinished(int returnCode, QProcess::ExitStatus) {
-  m_cursor.movePosition(QTextCursor::End);
-  m_cursor.insertBlock();
+  finishProcessOutput();
   disconnect(m_ui->extractBtn, &QPushButton::clicked, nullptr, nullptr);
   connect(m_ui->extractBtn, &QPushButton::clicked, this, &MainWindow::onExtract);
+  m_packageState.refresh();
   checkDownloadedBinary();
 }
 
 void MainWindow::onPackage() {
   if (m_path.isEmpty())
     return;
-  m_ui->processOutput->clear();
-  KillProcessTree(m_heclProc);
-  m_heclProc.setProcessChannelMode(QProcess::ProcessChannelMode::MergedChannels);
-  m_heclProc.setWorkingDirectory(m_path);
-  QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-  env.insert(QStringLiteral("TERM"), QStringLiteral("xterm-color"));
-  env.insert(QStringLiteral("ConEmuANSI"), QStringLiteral("ON"));
-  m_heclProc.setProcessEnvironment(env);
-  disconnect(&m_heclProc, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), nullptr, nullptr);
-  connect(&m_heclProc, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, &MainWindow::onPackageFinished);
-
-  const QStringList heclProcArguments{QStringLiteral("package"), QStringLiteral("MP1"), QStringLiteral("-y"),
-                                      QStringLiteral("-g")};
-  m_heclProc.start(m_heclPath, heclProcArguments, QIODevice::ReadOnly | QIODevice::Unbuffered);
+  if (m_ui->parallelPackageBox->isChecked())
+    startShardedPackage();
+  else
+    startConsoleJob(StagePipeline::packageJob(m_path, m_heclPath));
 
   m_ui->heclTabs->setCurrentIndex(0);
 
@@ -211,47 +169,164 @@ void MainWindow::onPackage() {
 }
 
 void MainWindow::onPackageFinished(int returnCode, QProcess::ExitStatus) {
-  m_cursor.movePosition(QTextCursor::End);
-  m_cursor.insertBlock();
+  finishProcessOutput();
   disconnect(m_ui->packageBtn, &QPushButton::clicked, nullptr, nullptr);
   connect(m_ui->packageBtn, &QPushButton::clicked, this, &MainWindow::onPackage);
+  m_packageState.refresh();
   checkDownloadedBinary();
 }
 
 void MainWindow::onLaunch() {
   if (m_path.isEmpty())
     return;
-  m_ui->processOutput->clear();
-  KillProcessTree(m_heclProc);
-  m_heclProc.setProcessChannelMode(QProcess::ProcessChannelMode::MergedChannels);
-  m_heclProc.setWorkingDirectory(m_path);
-  QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-  env.insert(QStringLiteral("TERM"), QStringLiteral("xterm-color"));
-  env.insert(QStringLiteral("ConEmuANSI"), QStringLiteral("ON"));
-  m_heclProc.setProcessEnvironment(env);
-  disconnect(&m_heclProc, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), nullptr, nullptr);
-  connect(&m_heclProc, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, &MainWindow::onLaunchFinished);
-
-  const auto heclProcArguments = QStringList{m_path + QStringLiteral("/out/MP1")}
-                                 << m_warpSettings << QStringLiteral("-l")
-                                 << m_settings.value(QStringLiteral("urde_arguments"))
-                                        .toStringList()
-                                        .join(QLatin1Char{' '})
-                                        .split(QLatin1Char{' '});
-  m_heclProc.start(m_urdePath, heclProcArguments, QIODevice::ReadOnly | QIODevice::Unbuffered);
+  startConsoleJob(StagePipeline::launchJob(m_path, m_urdePath, launchArguments()));
 
   m_ui->heclTabs->setCurrentIndex(0);
 
   disableOperations();
 }
 
+QStringList MainWindow::launchArguments() const {
+  const QString extraArguments =
+      m_settings.value(QStringLiteral("urde_arguments")).toStringList().join(QLatin1Char{' '});
+  return QStringList{m_path + QStringLiteral("/out/MP1")}
+         << m_warpSettings << QStringLiteral("-l") << extraArguments.split(QLatin1Char{' '});
+}
+
+void MainWindow::onRunAll() {
+  if (m_path.isEmpty() || m_heclPath.isEmpty())
+    return;
+
+  StagePipeline::Config config{m_path, m_heclPath, m_urdePath, {}, launchArguments(), true};
+  m_packageState.refresh();
+  if (!m_packageState.isExtracted()) {
+    // Unattended setups can name the image up front instead of answering the dialog
+    config.imagePath = m_settings.value(QStringLiteral("pipeline_image")).toString();
+    if (config.imagePath.isEmpty() || !QFileInfo::exists(config.imagePath))
+      config.imagePath =
+          QFileDialog::getOpenFileName(this, tr("Extract Image"), m_path, tr("Images (*.iso *.wbfs *.gcm)"));
+    if (config.imagePath.isEmpty())
+      return;
+  }
+
+  m_ui->heclTabs->setCurrentIndex(0);
+  disableOperations();
+  m_ui->runAllBtn->setText(tr("&Cancel"));
+  m_ui->runAllBtn->setEnabled(true);
+  disconnect(m_ui->runAllBtn, &QPushButton::clicked, nullptr, nullptr);
+  connect(m_ui->runAllBtn, &QPushButton::clicked, &m_pipeline, &StagePipeline::cancel);
+
+  m_pipeline.start(config);
+}
+
+void MainWindow::onPipelineStageStarted(StagePipeline::Stage, JobId job) {
+  // Like startConsoleJob, the console follows one job at a time
+  if (m_consoleJob != job)
+    m_jobs.cancel(m_consoleJob);
+  m_consoleJob = job;
+  beginProcessOutput(m_jobs.spec(job)->name);
+}
+
+void MainWindow::onPipelineFinished(bool, const QString& message) {
+  disconnect(m_ui->runAllBtn, &QPushButton::clicked, nullptr, nullptr);
+  connect(m_ui->runAllBtn, &QPushButton::clicked, this, &MainWindow::onRunAll);
+  m_ui->runAllBtn->setText(tr("&Run All"));
+  if (!message.isEmpty())
+    insertContinueNote(message);
+  // A launched game re-enables everything once it exits, like a plain launch
+  if (m_consoleJob == 0)
+    checkDownloadedBinary();
+  else
+    disableOperations();
+}
+
 void MainWindow::onLaunchFinished(int returnCode, QProcess::ExitStatus) {
-  m_cursor.movePosition(QTextCursor::End);
-  m_cursor.insertBlock();
+  finishProcessOutput();
   checkDownloadedBinary();
 }
 
-void MainWindow::doHECLTerminate() { KillProcessTree(m_heclProc); }
+void MainWindow::doHECLTerminate() {
+  m_shardedPackager.cancel();
+  m_jobs.cancel(m_consoleJob);
+}
+
+void MainWindow::startConsoleJob(const JobSpec& spec, bool clearConsole) {
+  // The previous job reports its end before the new session starts
+  m_jobs.cancel(m_consoleJob);
+  beginProcessOutput(spec.name, clearConsole);
+  m_consoleJob = m_jobs.start(spec);
+}
+
+void MainWindow::startShardedPackage() {
+  m_jobs.cancel(m_consoleJob);
+  beginProcessOutput(QStringLiteral("package"));
+
+  m_packageState.refresh();
+  QStringList shards;
+  for (const QString& shard : ShardedPackager::worldShards()) {
+    if (!m_packageState.isPakPresent(shard + QStringLiteral(".upak")))
+      shards.push_back(shard);
+  }
+  const quint64 memory = ShardedPackager::availableMemory(m_ui->sysReqTable->getModel().memorySize());
+  const int concurrency =
+      std::max(1, std::min(ShardedPackager::concurrencyFor(QThread::idealThreadCount(), memory), int(shards.size())));
+  if (!shards.isEmpty())
+    appendConsoleNote(tr("Packaging %1 worlds, %2 at a time").arg(shards.size()).arg(concurrency));
+  m_shardedPackager.start(m_path, m_heclPath, shards, concurrency,
+                          m_settings.value(QStringLiteral("session_logs"), true).toBool());
+}
+
+void MainWindow::onShardFinished(const QString& name, const JobResult& result, const QStringList& tail) {
+  if (result.succeeded()) {
+    appendConsoleNote(tr("%1: done in %2 s").arg(name).arg(result.elapsedMsec / 1000.0, 0, 'f', 1), QColor(0, 255, 0));
+    return;
+  }
+  if (result.state == JobResult::State::Cancelled) {
+    appendConsoleNote(tr("%1: cancelled").arg(name), QColor(255, 255, 0));
+    return;
+  }
+  appendConsoleNote(result.state == JobResult::State::FailedToStart
+                        ? tr("%1: failed to start").arg(name)
+                        : tr("%1: failed with exit code %2, last output:").arg(name).arg(result.exitCode),
+                    QColor(255, 0, 0));
+  for (const QString& line : tail)
+    appendConsoleNote(line);
+}
+
+void MainWindow::onShardedPackageFinished(bool success) {
+  if (!success) {
+    onPackageFinished(1, QProcess::NormalExit);
+    return;
+  }
+  // The shared paks, and anything the shards left out, come from one ordinary package run
+  startConsoleJob(StagePipeline::packageJob(m_path, m_heclPath), false);
+}
+
+void MainWindow::onJobFinished(JobId id, const JobResult& result) {
+  if (id != m_consoleJob)
+    return;
+  m_consoleJob = 0;
+  // Between pipeline stages the UI stays busy and binaries aren't probed again
+  if (m_pipeline.isRunning()) {
+    finishProcessOutput();
+    return;
+  }
+  const auto exitStatus = result.state == JobResult::State::Crashed ? QProcess::CrashExit : QProcess::NormalExit;
+  switch (result.spec.kind) {
+  case JobKind::Extract:
+    onExtractFinished(result.exitCode, exitStatus);
+    break;
+  case JobKind::Package:
+    onPackageFinished(result.exitCode, exitStatus);
+    break;
+  case JobKind::Launch:
+    onLaunchFinished(result.exitCode, exitStatus);
+    break;
+  case JobKind::Other:
+    finishProcessOutput();
+    break;
+  }
+}
 
 void MainWindow::onReturnPressed() {
   if (sender() == m_ui->pathEdit)
@@ -272,41 +347,59 @@ void MainWindow::onIndexDownloaded(const QStringList& index) {
 
   if (!m_path.isEmpty()) {
     checkDownloadedBinary();
-    m_ui->downloadButton->setEnabled(true);
+    m_ui->downloadButton->setEnabled(!isBusy());
   }
 }
 
 void MainWindow::onDownloadPressed() {
   QString filename = m_ui->binaryComboBox->currentData().value<URDEVersion>().fileString(true);
-#if PLATFORM_ZIP_DOWNLOAD
+  if (!m_dlManager.zipDownload()) {
+    // Only opens the release page; nothing comes back to install
+    m_dlManager.fetchBinary(filename, m_path + QLatin1Char{'/'} + filename);
+    return;
+  }
+
   disableOperations();
   m_ui->downloadButton->setEnabled(false);
-#endif
-  m_dlManager.fetchBinary(filename, m_path + QLatin1Char{'/'} + filename);
+  // New binaries are staged beside the current ones and swapped in only once complete
+  m_stagedInstall = std::make_unique<StagedInstall>(m_path);
+  // With a manifest from a previous install, extracting after the download lets unchanged files be skipped
+  const QString streamExtractDir = ExtractZip::hasManifest(m_path) ? QString() : m_stagedInstall->stagingDir();
+  m_dlManager.fetchBinary(filename, m_path + QLatin1Char{'/'} + filename, streamExtractDir);
 }
 
-void MainWindow::onBinaryDownloaded(QuaZip& file) {
-  const bool err = !ExtractZip::extractDir(file, m_path);
+void MainWindow::onBinaryDownloaded(const QString& archivePath, bool extracted) {
+  m_ui->downloadErrorLabel->setText(tr("Installing..."), true);
+  m_stagedInstall->commitArchiveAsync(
+      archivePath, extracted, this,
+      [this, extracted](bool ok, const QStringList& rewritten, const QString& installError) {
+        onBinaryInstalled(ok, extracted, rewritten, installError);
+      });
+}
+
+void MainWindow::onBinaryInstalled(bool ok, bool extracted, const QStringList& rewritten,
+                                   const QString& installError) {
+  const bool err = !ok;
+  m_stagedInstall.reset();
 
-  if (err) {
+  if (!installError.isEmpty()) {
+    m_ui->downloadErrorLabel->setText(installError);
+  } else if (err) {
     m_ui->downloadErrorLabel->setText(tr("Error extracting zip"));
+  } else if (!extracted) {
+    m_ui->downloadErrorLabel->setText(tr("Download successful - %n file(s) updated", nullptr, rewritten.size()), true);
   } else {
     m_ui->downloadErrorLabel->setText(tr("Download successful"), true);
   }
 
   m_ui->downloadButton->setEnabled(true);
+  // Follow-up hints are shown once the new binaries have been probed
+  m_binaryJustDownloaded = !err;
   checkDownloadedBinary();
-
-  if (!err && m_ui->extractBtn->isEnabled()) {
-    m_ui->downloadErrorLabel->setText(tr("Download successful - Press 'Extract' to continue."), true);
-  }
-  if (!err && !m_ui->sysReqTable->isBlenderVersionOk()) {
-    m_ui->downloadErrorLabel->setText(
-        tr("Blender 2.90 or greater must be installed. Please download via Steam or blender.org."));
-  }
 }
 
 void MainWindow::onBinaryFailed() {
+  m_stagedInstall.reset();
   m_ui->downloadButton->setEnabled(true);
   checkDownloadedBinary();
 }
@@ -315,6 +408,7 @@ void MainWindow::disableOperations() {
   m_ui->extractBtn->setEnabled(false);
   m_ui->packageBtn->setEnabled(false);
   m_ui->launchBtn->setEnabled(false);
+  m_ui->runAllBtn->setEnabled(false);
   m_ui->pathEdit->setEnabled(false);
   m_ui->browseBtn->setEnabled(false);
   m_ui->downloadButton->setEnabled(false);
@@ -343,11 +437,13 @@ void MainWindow::enableOperations() {
   m_ui->extractBtn->setText(tr("&Extract"));
   m_ui->packageBtn->setText(tr("&Package"));
   m_ui->launchBtn->setText(tr("&Launch"));
+  m_ui->runAllBtn->setText(tr("&Run All"));
 
   m_ui->extractBtn->setEnabled(true);
-  if (QFile::exists(m_path + QStringLiteral("/out/files/MP1/version.yaml"))) {
+  m_ui->runAllBtn->setEnabled(!m_urdePath.isEmpty());
+  if (m_packageState.isExtracted()) {
     m_ui->packageBtn->setEnabled(true);
-    if (isPackageComplete()) {
+    if (m_packageState.isPackageComplete()) {
       m_ui->launchBtn->setEnabled(true);
       if (hecl::com_enableCheats->toBoolean()) {
         m_ui->warpBtn->setEnabled(true);
@@ -366,92 +462,69 @@ void MainWindow::enableOperations() {
   }
 }
 
-bool MainWindow::isPackageComplete() const {
-  return QFile::exists(m_path + QStringLiteral("/out/files/MP1/AudioGrp.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/GGuiSys.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/Metroid1.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/Metroid2.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/Metroid3.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/Metroid4.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/metroid5.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/Metroid6.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/Metroid7.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/Metroid8.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/MidiData.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/MiscData.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/NoARAM.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/SamGunFx.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/SamusGun.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/SlideShow.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/TestAnim.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/Tweaks.upak")) &&
-         QFile::exists(m_path + QStringLiteral("/out/files/MP1/URDE.upak"));
-}
-
-static bool GetDLPackage(const QString& path, QString& dlPackage) {
-  QProcess proc;
-  proc.start(path, {QStringLiteral("--dlpackage")}, QIODevice::ReadOnly);
-  if (proc.waitForStarted()) {
-    proc.waitForFinished();
-    if (proc.exitCode() == 100)
-      dlPackage = QString::fromUtf8(proc.readLine()).trimmed();
-    return true;
-  }
-  return false;
-}
-
-bool MainWindow::checkDownloadedBinary() {
-  m_urdePath = QString();
-  m_heclPath = QString();
-
+void MainWindow::checkDownloadedBinary() {
   if (m_path.isEmpty()) {
+    m_urdePath = QString();
+    m_heclPath = QString();
+    m_binaryJustDownloaded = false;
     m_ui->heclTabs->setCurrentIndex(2);
     m_ui->downloadErrorLabel->setText(tr("Set working directory to continue."), true);
     enableOperations();
-    return false;
+    return;
   }
 
-  const QString dir = QApplication::instance()->applicationDirPath();
-#if _WIN32
-  QString urdePath = dir + QStringLiteral("/urde.exe");
-  QString heclPath = dir + QStringLiteral("/hecl.exe");
-  QString visigenPath = dir + QStringLiteral("/visigen.exe");
-  if (!QFileInfo::exists(urdePath) || !QFileInfo::exists(heclPath) || !QFileInfo::exists(visigenPath)) {
-    urdePath = m_path + QStringLiteral("/urde.exe");
-    heclPath = m_path + QStringLiteral("/hecl.exe");
-    visigenPath = m_path + QStringLiteral("/visigen.exe");
+  // Completes in onBinariesProbed, immediately if all three binaries are unchanged
+  m_binaryProbe.probe(BinaryVersionProbe::binaryPaths(m_path));
+}
+
+bool MainWindow::isBusy() const {
+  return m_consoleJob != 0 || m_pipeline.isRunning() || m_shardedPackager.isRunning() || m_stagedInstall;
+}
+
+void MainWindow::onBinariesProbed(const QVector<BinaryVersionProbe::Result>& results) {
+  const BinaryVersionProbe::Result& urde = results[0];
+  const BinaryVersionProbe::Result& hecl = results[1];
+  const BinaryVersionProbe::Result& visigen = results[2];
+  const bool found = urde.found && hecl.found && visigen.found;
+  if (!found) {
+    m_ui->currentBinaryLabel->setText(tr("none"));
+  } else if (!urde.dlPackage.isEmpty() && urde.dlPackage == hecl.dlPackage && urde.dlPackage == visigen.dlPackage) {
+    URDEVersion v(urde.dlPackage);
+    m_ui->currentBinaryLabel->setText(v.fileString(false));
+  } else {
+    m_ui->currentBinaryLabel->setText(tr("unknown -- re-download recommended"));
   }
-#else
-  QString urdePath = dir + QStringLiteral("/urde");
-  QString heclPath = dir + QStringLiteral("/hecl");
-  QString visigenPath = dir + QStringLiteral("/visigen");
-#endif
-  urdePath = QFileInfo(urdePath).absoluteFilePath();
-  heclPath = QFileInfo(heclPath).absoluteFilePath();
-  visigenPath = QFileInfo(visigenPath).absoluteFilePath();
-
-  QString urdeDlPackage, heclDlPackage, visigenDlPackage;
-  if (GetDLPackage(urdePath, urdeDlPackage) && GetDLPackage(heclPath, heclDlPackage) &&
-      GetDLPackage(visigenPath, visigenDlPackage)) {
-    if (!urdeDlPackage.isEmpty() && urdeDlPackage == heclDlPackage && urdeDlPackage == visigenDlPackage) {
-      URDEVersion v(urdeDlPackage);
-      m_ui->currentBinaryLabel->setText(v.fileString(false));
-    } else {
-      m_ui->currentBinaryLabel->setText(tr("unknown -- re-download recommended"));
-    }
 
-    m_urdePath = urdePath;
-    m_heclPath = heclPath;
+  // A probe can land while a job or download is running; its end probes again and restores the buttons
+  if (isBusy())
+    return;
+
+  m_urdePath = QString();
+  m_heclPath = QString();
+  const bool justDownloaded = std::exchange(m_binaryJustDownloaded, false);
+  if (found) {
+    m_urdePath = urde.path;
+    m_heclPath = hecl.path;
     m_ui->downloadErrorLabel->setText({}, true);
     enableOperations();
-    return true;
+
+    if (justDownloaded && m_ui->extractBtn->isEnabled()) {
+      m_ui->downloadErrorLabel->setText(tr("Download successful - Press 'Extract' to continue."), true);
+    }
+    if (justDownloaded && !m_ui->sysReqTable->isBlenderVersionOk()) {
+      m_ui->downloadErrorLabel->setText(
+          tr("Blender 2.90 or greater must be installed. Please download via Steam or blender.org."));
+    }
+    return;
   }
 
-  m_ui->currentBinaryLabel->setText(tr("none"));
   m_ui->heclTabs->setCurrentIndex(2);
   m_ui->downloadErrorLabel->setText(tr("Press 'Download' to fetch latest URDE binary."), true);
   enableOperations();
-  return false;
+  if (justDownloaded && !m_ui->sysReqTable->isBlenderVersionOk()) {
+    m_ui->downloadErrorLabel->setText(
+        tr("Blender 2.90 or greater must be installed. Please download via Steam or blender.org."));
+  }
 }
 
 void MainWindow::setPath(const QString& path) {
@@ -491,18 +564,38 @@ void MainWindow::setPath(const QString& path) {
   }
 
   m_ui->sysReqTable->updateFreeDiskSpace(m_path);
+  m_packageState.setPath(m_path);
   checkDownloadedBinary();
 }
 
 void MainWindow::initSlots() {
-  connect(&m_heclProc, &QProcess::readyRead, [this]() {
-    const QByteArray bytes = m_heclProc.readAll();
-    setTextTermFormatting(QString::fromUtf8(bytes));
+  connect(&m_binaryProbe, &BinaryVersionProbe::probed, this, &MainWindow::onBinariesProbed);
+  connect(&m_packageState, &PackageStateTracker::stateChanged, this, [this](int present, int expected) {
+    m_ui->packageBtn->setToolTip(tr("%1 of %2 paks present").arg(present).arg(expected));
   });
 
+  m_outputPump.setSink(&m_progressFilter);
+  m_outputPump.setFlushHandler([this] { onConsoleOutput(); });
+  m_outputPump.setInputTap([this](const char* data, qint64 len) { m_sessionLog.append(data, len); });
+  connect(&m_jobs, &JobRunner::jobOutput, this, [this](JobId id, QIODevice* output) {
+    if (id == m_consoleJob)
+      m_outputPump.appendFrom(*output);
+  });
+  connect(&m_jobs, &JobRunner::jobFinished, this, &MainWindow::onJobFinished);
+
   connect(m_ui->extractBtn, &QPushButton::clicked, this, &MainWindow::onExtract);
   connect(m_ui->packageBtn, &QPushButton::clicked, this, &MainWindow::onPackage);
   connect(m_ui->launchBtn, &QPushButton::clicked, this, &MainWindow::onLaunch);
+  connect(m_ui->runAllBtn, &QPushButton::clicked, this, &MainWindow::onRunAll);
+  connect(&m_pipeline, &StagePipeline::stageStarted, this, &MainWindow::onPipelineStageStarted);
+  connect(&m_pipeline, &StagePipeline::finished, this, &MainWindow::onPipelineFinished);
+  connect(&m_shardedPackager, &ShardedPackager::shardStarted, this,
+          [this](const QString& name, const QString& logPath) {
+            appendConsoleNote(logPath.isEmpty() ? tr("%1: started").arg(name)
+                                                : tr("%1: started, logging to %2").arg(name, logPath));
+          });
+  connect(&m_shardedPackager, &ShardedPackager::shardFinished, this, &MainWindow::onShardFinished);
+  connect(&m_shardedPackager, &ShardedPackager::finished, this, &MainWindow::onShardedPackageFinished);
 
   connect(m_ui->browseBtn, &QPushButton::clicked, [this]() {
     FileDirDialog dialog(this);
@@ -522,50 +615,32 @@ void MainWindow::initSlots() {
   connect(m_ui->downloadButton, &QPushButton::clicked, this, &MainWindow::onDownloadPressed);
 }
 
-void MainWindow::setTextTermFormatting(const QString& text) {
+void MainWindow::onConsoleOutput() {
   m_inContinueNote = false;
+  m_progressFilter.flushPending();
+  m_ui->processOutput->contentsChanged();
+  m_progressModel.publish();
+}
 
-  m_cursor.beginEditBlock();
-  // TODO: Migrate QRegExp to QRegularExpression
-  QRegExp const escapeSequenceExpression(QStringLiteral(R"(\x1B\[([\d;\?FA]+)([mlh]?))"));
-  QTextCharFormat defaultTextCharFormat = m_cursor.charFormat();
-  int offset = escapeSequenceExpression.indexIn(text);
-  ReturnInsert(m_cursor, text.mid(0, offset));
-  QTextCharFormat textCharFormat = defaultTextCharFormat;
-  while (offset >= 0) {
-    int previousOffset = offset + escapeSequenceExpression.matchedLength();
-    QStringList captures = escapeSequenceExpression.capturedTexts();
-    if (captures.size() >= 3 && captures[2] == QStringLiteral("m")) {
-      QStringList capturedTexts = captures[1].split(QLatin1Char{';'});
-      QListIterator<QString> i(capturedTexts);
-      while (i.hasNext()) {
-        bool ok = false;
-        int attribute = i.next().toInt(&ok);
-        Q_ASSERT(ok);
-        ParseEscapeSequence(attribute, i, textCharFormat, defaultTextCharFormat);
-      }
-    } else if (captures.size() >= 2 &&
-               (captures[1].endsWith(QLatin1Char{'F'}) || captures[1].endsWith(QLatin1Char{'A'}))) {
-      int lineCount = captures[1].chopped(1).toInt();
-      if (!lineCount)
-        lineCount = 1;
-      for (int i = 0; i < lineCount; ++i) {
-        m_cursor.movePosition(QTextCursor::PreviousBlock);
-        m_cursor.select(QTextCursor::BlockUnderCursor);
-        m_cursor.removeSelectedText();
-        m_cursor.insertBlock();
-      }
-    }
-    offset = escapeSequenceExpression.indexIn(text, previousOffset);
-    if (offset < 0) {
-      ReturnInsert(m_cursor, text.mid(previousOffset), textCharFormat);
-    } else {
-      ReturnInsert(m_cursor, text.mid(previousOffset, offset - previousOffset), textCharFormat);
-    }
-  }
-  m_cursor.setCharFormat(defaultTextCharFormat);
-  m_cursor.endEditBlock();
-  m_ui->processOutput->ensureCursorVisible();
+void MainWindow::beginProcessOutput(const QString& session, bool clearConsole) {
+  if (m_settings.value(QStringLiteral("session_logs"), true).toBool())
+    m_sessionLog.begin(m_path, session);
+  if (clearConsole)
+    m_ui->processOutput->clear();
+  else
+    m_ui->processOutput->log().flushTail();
+  m_outputPump.clear();
+  m_progressFilter.reset();
+  m_progressModel.reset();
+}
+
+void MainWindow::finishProcessOutput() {
+  m_outputPump.drain();
+  m_progressFilter.finish();
+  m_progressModel.reset();
+  m_ui->processOutput->log().flushTail();
+  m_ui->processOutput->contentsChanged();
+  m_sessionLog.end();
 }
 
 void MainWindow::insertContinueNote(const QString& text) {
@@ -573,12 +648,17 @@ void MainWindow::insertContinueNote(const QString& text) {
     return;
   m_inContinueNote = true;
 
-  m_cursor.movePosition(QTextCursor::End);
-  QTextCharFormat textCharFormat = m_cursor.charFormat();
-  textCharFormat.setForeground(QColor(0, 255, 0));
-  m_cursor.insertText(text, textCharFormat);
-  m_cursor.insertBlock();
-  m_ui->processOutput->ensureCursorVisible();
+  appendConsoleNote(text, QColor(0, 255, 0));
+}
+
+void MainWindow::appendConsoleNote(const QString& text, const QColor& color) {
+  TermFormat noteFormat;
+  if (color.isValid())
+    noteFormat.setForeground(color);
+  ConsoleLog& log = m_ui->processOutput->log();
+  log.text(text.constData(), text.size(), m_outputPump.formats().intern(noteFormat));
+  log.lineFeed();
+  m_ui->processOutput->contentsChanged();
 }
 
 void MainWindow::onUpdateTrackChanged(int index) {
@@ -630,6 +710,10 @@ void MainWindow::initOptions() {
     m_cvarManager.serialize();
   });
 
+  m_ui->parallelPackageBox->setChecked(m_settings.value(QStringLiteral("parallel_package"), false).toBool());
+  connect(m_ui->parallelPackageBox, &QCheckBox::toggled, this,
+          [this](bool checked) { m_settings.setValue(QStringLiteral("parallel_package"), checked); });
+
   initCheckboxOption(m_ui->developerModeBox, hecl::com_developer);
   initCheckboxOption(m_ui->enableCheatsBox, hecl::com_enableCheats);
   initCheckboxOption(m_ui->variableDtBox, m_cvarCommons.m_variableDt);
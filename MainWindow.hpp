@@ -2,15 +2,26 @@
 
 #include <memory>
 
+#include <QColor>
 #include <QMainWindow>
 #include <QProcess>
-#include <QTextCursor>
 #include <QCheckBox>
 #include <QComboBox>
 #include <QRadioButton>
 
+#include "BinaryVersionProbe.hpp"
 #include "Common.hpp"
+#include "ConsoleOutputPump.hpp"
+#include "ConsoleProgress.hpp"
 #include "DownloadManager.hpp"
+#include "JobRunner.hpp"
+#include "PackageStateTracker.hpp"
+#include "ProcessMonitor.hpp"
+#include "ProgressRecognizer.hpp"
+#include "SessionLog.hpp"
+#include "ShardedPackager.hpp"
+#include "StagePipeline.hpp"
+#include "StagedInstall.hpp"
 
 #include <hecl/CVarCommons.hpp>
 #include <hecl/Runtime.hpp>
@@ -18,7 +29,6 @@
 class QPushButton;
 class QTextCharFormat;
 class QTextEdit;
-class QuaZip;
 
 namespace Ui {
 class MainWindow;
@@ -31,12 +41,23 @@ class MainWindow : public QMainWindow {
   hecl::Runtime::FileStoreManager m_fileMgr;
   hecl::CVarManager m_cvarManager;
   hecl::CVarCommons m_cvarCommons;
-  QTextCursor m_cursor;
   QString m_path;
   QString m_urdePath;
   QString m_heclPath;
-  QProcess m_heclProc;
+  JobRunner m_jobs;
+  JobId m_consoleJob = 0;
+  ConsoleOutputPump m_outputPump;
+  ConsoleProgressModel m_progressModel;
+  ProgressRecognizer m_progressFilter;
+  SessionLog m_sessionLog;
   DownloadManager m_dlManager;
+  BinaryVersionProbe m_binaryProbe;
+  PackageStateTracker m_packageState;
+  StagePipeline m_pipeline;
+  ShardedPackager m_shardedPackager;
+  ProcessMonitor m_processMonitor;
+  bool m_binaryJustDownloaded = false;
+  std::unique_ptr<StagedInstall> m_stagedInstall;
   QStringList m_warpSettings;
   QSettings m_settings;
   URDEVersion m_recommendedVersion;
@@ -47,7 +68,6 @@ public:
   explicit MainWindow(QWidget* parent = nullptr);
   ~MainWindow() override;
 
-  void setTextTermFormatting(const QString& text);
   void insertContinueNote(const QString& text);
 
 private slots:
@@ -57,6 +77,7 @@ private slots:
   void onPackageFinished(int exitCode, QProcess::ExitStatus);
   void onLaunch();
   void onLaunchFinished(int exitCode, QProcess::ExitStatus);
+  void onRunAll();
   void doHECLTerminate();
   void onReturnPressed();
   void onDownloadPressed();
@@ -64,15 +85,29 @@ private slots:
   void onUpdateTrackChanged(int index);
 
 private:
-  bool checkDownloadedBinary();
+  void startConsoleJob(const JobSpec& spec, bool clearConsole = true);
+  void startShardedPackage();
+  void onShardFinished(const QString& name, const JobResult& result, const QStringList& tail);
+  void onShardedPackageFinished(bool success);
+  void appendConsoleNote(const QString& text, const QColor& color = QColor());
+  QStringList launchArguments() const;
+  void onPipelineStageStarted(StagePipeline::Stage stage, JobId job);
+  void onPipelineFinished(bool success, const QString& message);
+  void onJobFinished(JobId id, const JobResult& result);
+  void onConsoleOutput();
+  void beginProcessOutput(const QString& session, bool clearConsole = true);
+  void finishProcessOutput();
+  void checkDownloadedBinary();
+  bool isBusy() const;
+  void onBinariesProbed(const QVector<BinaryVersionProbe::Result>& results);
   void setPath(const QString& path);
   void initSlots();
   void onIndexDownloaded(const QStringList& index);
-  void onBinaryDownloaded(QuaZip& file);
+  void onBinaryDownloaded(const QString& archivePath, bool extracted);
+  void onBinaryInstalled(bool ok, bool extracted, const QStringList& rewritten, const QString& installError);
   void onBinaryFailed();
   void disableOperations();
   void enableOperations();
-  bool isPackageComplete() const;
   void initOptions();
   void initGraphicsApiOption(QRadioButton* action, bool hidden, bool isDefault);
   void initNumberComboOption(QComboBox* action, hecl::CVar* cvar);
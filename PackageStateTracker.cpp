@@ -0,0 +1,90 @@
+#include "PackageStateTracker.hpp"
+
+#include <QDir>
+#include <QSet>
+
+const QStringList PackageStateTracker::skExpectedPaks = {
+    QStringLiteral("AudioGrp.upak"),  QStringLiteral("GGuiSys.upak"),   QStringLiteral("Metroid1.upak"),
+    QStringLiteral("Metroid2.upak"),  QStringLiteral("Metroid3.upak"),  QStringLiteral("Metroid4.upak"),
+    QStringLiteral("metroid5.upak"),  QStringLiteral("Metroid6.upak"),  QStringLiteral("Metroid7.upak"),
+    QStringLiteral("Metroid8.upak"),  QStringLiteral("MidiData.upak"),  QStringLiteral("MiscData.upak"),
+    QStringLiteral("NoARAM.upak"),    QStringLiteral("SamGunFx.upak"),  QStringLiteral("SamusGun.upak"),
+    QStringLiteral("SlideShow.upak"), QStringLiteral("TestAnim.upak"),  QStringLiteral("Tweaks.upak"),
+    QStringLiteral("URDE.upak"),
+};
+
+#if _WIN32 || __APPLE__
+// Names match the way QFile::exists() resolves them on these platforms' default file systems
+constexpr Qt::CaseSensitivity FileNameCase = Qt::CaseInsensitive;
+#else
+constexpr Qt::CaseSensitivity FileNameCase = Qt::CaseSensitive;
+#endif
+
+static QString FileNameKey(const QString& name) {
+  return FileNameCase == Qt::CaseInsensitive ? name.toCaseFolded() : name;
+}
+
+PackageStateTracker::PackageStateTracker(QObject* parent)
+: QObject(parent), m_watcher(this), m_rescanTimer(this), m_present(skExpectedPaks.size(), false) {
+  // hecl writes many files in bursts; coalesce the resulting notifications
+  m_rescanTimer.setSingleShot(true);
+  m_rescanTimer.setInterval(100);
+  connect(&m_rescanTimer, &QTimer::timeout, this, &PackageStateTracker::refresh);
+  connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, [this] { m_rescanTimer.start(); });
+}
+
+void PackageStateTracker::setPath(const QString& workingDir) {
+  m_mp1Dir = workingDir.isEmpty() ? QString() : QDir::cleanPath(workingDir + QStringLiteral("/out/files/MP1"));
+  rescan(true);
+}
+
+void PackageStateTracker::refresh() { rescan(false); }
+
+bool PackageStateTracker::isPakPresent(const QString& pak) const {
+  for (int i = 0; i < skExpectedPaks.size(); ++i)
+    if (skExpectedPaks[i].compare(pak, FileNameCase) == 0)
+      return m_present[i];
+  return false;
+}
+
+void PackageStateTracker::rescan(bool forceNotify) {
+  rewatch();
+
+  QSet<QString> entries;
+  if (!m_mp1Dir.isEmpty()) {
+    for (const QString& name : QDir(m_mp1Dir).entryList(QDir::Files | QDir::Hidden))
+      entries.insert(FileNameKey(name));
+  }
+
+  const bool extracted = entries.contains(FileNameKey(QStringLiteral("version.yaml")));
+  int presentCount = 0;
+  bool changed = forceNotify || extracted != m_extracted;
+  for (int i = 0; i < skExpectedPaks.size(); ++i) {
+    const bool present = entries.contains(FileNameKey(skExpectedPaks[i]));
+    changed |= present != m_present[i];
+    m_present[i] = present;
+    presentCount += present;
+  }
+  m_extracted = extracted;
+  m_presentCount = presentCount;
+
+  if (changed)
+    emit stateChanged(m_presentCount, skExpectedPaks.size());
+}
+
+/* Watches MP1 itself, or while it doesn't exist yet, its nearest existing ancestor */
+void PackageStateTracker::rewatch() {
+  QString watchPath = m_mp1Dir;
+  while (!watchPath.isEmpty() && !QFileInfo(watchPath).isDir()) {
+    const QString parent = QFileInfo(watchPath).absolutePath();
+    watchPath = parent != watchPath ? parent : QString();
+  }
+
+  const QStringList watched = m_watcher.directories();
+  if (watched.size() == 1 && watched.front() == watchPath)
+    return;
+  if (!watched.isEmpty())
+    m_watcher.removePaths(watched);
+  if (!watchPath.isEmpty())
+    m_watcher.addPath(watchPath);
+}
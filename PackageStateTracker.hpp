@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+/**
+ * Tracks which outputs of `hecl extract`/`hecl package` exist under <working dir>/out/files/MP1.
+ * The directory is listed once when the path is set and again only when the file system watcher
+ * reports a change, so queries are answered from cached state.
+ */
+class PackageStateTracker : public QObject {
+  Q_OBJECT
+
+public:
+  static const QStringList skExpectedPaks;
+
+  explicit PackageStateTracker(QObject* parent = Q_NULLPTR);
+
+  void setPath(const QString& workingDir);
+  bool isExtracted() const { return m_extracted; }
+  bool isPackageComplete() const { return m_presentCount == skExpectedPaks.size(); }
+  int presentPaks() const { return m_presentCount; }
+  int expectedPaks() const { return skExpectedPaks.size(); }
+  bool isPakPresent(const QString& pak) const;
+  // Forces a rescan, e.g. after a job that may have raced the watcher finished
+  void refresh();
+
+signals:
+  void stateChanged(int presentPaks, int expectedPaks);
+
+private:
+  void rescan(bool forceNotify);
+  void rewatch();
+
+  QString m_mp1Dir;
+  QFileSystemWatcher m_watcher;
+  QTimer m_rescanTimer;
+  QVector<bool> m_present;
+  int m_presentCount = 0;
+  bool m_extracted = false;
+};
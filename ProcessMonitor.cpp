@@ -0,0 +1,181 @@
+#include "ProcessMonitor.hpp"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+
+#if __linux__
+#include <unistd.h>
+#endif
+
+#if __linux__
+namespace {
+struct StatLine {
+  qint64 ppid = 0;
+  QString name;
+  quint64 cpuTicks = 0;
+  quint64 rssPages = 0;
+};
+
+bool ReadStat(qint64 pid, StatLine& out) {
+  QFile file(QStringLiteral("/proc/%1/stat").arg(pid));
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+  const QByteArray data = file.readAll();
+  // The command name is parenthesized and may itself contain spaces and parentheses
+  const int open = data.indexOf('(');
+  const int close = data.lastIndexOf(')');
+  if (open < 0 || close < open)
+    return false;
+  out.name = QString::fromUtf8(data.mid(open + 1, close - open - 1));
+  // fields[0] is field 3 of proc(5), the process state
+  const QList<QByteArray> fields = data.mid(close + 2).split(' ');
+  if (fields.size() < 22)
+    return false;
+  out.ppid = fields[1].toLongLong();
+  out.cpuTicks = fields[11].toULongLong() + fields[12].toULongLong(); // utime + stime
+  out.rssPages = fields[21].toULongLong();
+  return true;
+}
+
+/* Storage I/O only; needs the same user as the process, which all of ours are */
+void ReadIo(qint64 pid, quint64& readBytes, quint64& writeBytes) {
+  QFile file(QStringLiteral("/proc/%1/io").arg(pid));
+  if (!file.open(QIODevice::ReadOnly))
+    return;
+  for (const QByteArray& line : file.readAll().split('\n')) {
+    if (line.startsWith("read_bytes: "))
+      readBytes = line.mid(12).toULongLong();
+    else if (line.startsWith("write_bytes: "))
+      writeBytes = line.mid(13).toULongLong();
+  }
+}
+
+double Rate(quint64 current, quint64 previous, double seconds) {
+  // A counter that went backwards belongs to a reused pid
+  return current >= previous ? double(current - previous) / seconds : 0.0;
+}
+} // namespace
+#endif
+
+ProcessMonitor::ProcessMonitor(QObject* parent) : QObject(parent), m_timer(this) {
+  m_timer.setInterval(DefaultInterval);
+  connect(&m_timer, &QTimer::timeout, this, &ProcessMonitor::sample);
+  m_clock.start();
+  if (isSupported())
+    m_timer.start();
+}
+
+bool ProcessMonitor::isSupported() {
+#if __linux__
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ProcessMonitor::clearSeries() {
+  m_series.clear();
+  emit sampled();
+}
+
+bool ProcessMonitor::writeCsv(QIODevice& out) const {
+  if (out.write("timestamp,processes,cpu_percent,rss_bytes,read_bytes_per_sec,write_bytes_per_sec\n") < 0)
+    return false;
+  for (const Sample& sample : m_series) {
+    const QByteArray line = QDateTime::fromMSecsSinceEpoch(sample.timestamp).toString(Qt::ISODateWithMs).toUtf8() +
+                            ',' + QByteArray::number(sample.processes) + ',' +
+                            QByteArray::number(sample.cpuPercent, 'f', 1) + ',' + QByteArray::number(sample.rssBytes) +
+                            ',' + QByteArray::number(sample.readBytesPerSec, 'f', 0) + ',' +
+                            QByteArray::number(sample.writeBytesPerSec, 'f', 0) + '\n';
+    if (out.write(line) != line.size())
+      return false;
+  }
+  return true;
+}
+
+void ProcessMonitor::sample() {
+#if __linux__
+  const QVector<qint64> roots = m_rootProvider ? m_rootProvider() : QVector<qint64>();
+  const qint64 now = m_clock.elapsed();
+  const double seconds = m_lastSampleMsec >= 0 ? double(now - m_lastSampleMsec) / 1000.0 : 0.0;
+  m_lastSampleMsec = now;
+
+  if (roots.isEmpty()) {
+    if (!m_processes.empty()) {
+      m_processes.clear();
+      m_previous.clear();
+      emit sampled();
+    }
+    return;
+  }
+
+  // One pass over /proc gives every parent link; the trees are then walked from the roots
+  std::unordered_map<qint64, StatLine> stats;
+  std::unordered_map<qint64, std::vector<qint64>> children;
+  const QStringList procEntries =
+      QDir(QStringLiteral("/proc")).entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::NoSort);
+  for (const QString& entry : procEntries) {
+    bool isPid = false;
+    const qint64 pid = entry.toLongLong(&isPid);
+    StatLine stat;
+    if (!isPid || !ReadStat(pid, stat))
+      continue;
+    children[stat.ppid].push_back(pid);
+    stats.emplace(pid, std::move(stat));
+  }
+
+  std::vector<qint64> tree;
+  for (qint64 root : roots) {
+    if (root > 0 && stats.count(root))
+      tree.push_back(root);
+  }
+  for (size_t i = 0; i < tree.size(); ++i) {
+    const auto it = children.find(tree[i]);
+    if (it != children.end())
+      tree.insert(tree.end(), it->second.begin(), it->second.end());
+  }
+
+  static const double ticksPerSecond = double(sysconf(_SC_CLK_TCK));
+  static const quint64 pageSize = quint64(sysconf(_SC_PAGESIZE));
+
+  Sample total;
+  total.timestamp = QDateTime::currentMSecsSinceEpoch();
+  total.processes = int(tree.size());
+  std::unordered_map<qint64, Counters> current;
+  m_processes.clear();
+  for (qint64 pid : tree) {
+    const StatLine& stat = stats[pid];
+    Counters counters;
+    counters.cpuTicks = stat.cpuTicks;
+    ReadIo(pid, counters.readBytes, counters.writeBytes);
+
+    ProcessSample process;
+    process.pid = pid;
+    process.ppid = stat.ppid;
+    process.name = stat.name;
+    process.rssBytes = stat.rssPages * pageSize;
+    const auto previous = m_previous.find(pid);
+    if (previous != m_previous.end() && seconds > 0.0) {
+      process.cpuPercent = Rate(counters.cpuTicks, previous->second.cpuTicks, seconds) * 100.0 / ticksPerSecond;
+      process.readBytesPerSec = Rate(counters.readBytes, previous->second.readBytes, seconds);
+      process.writeBytesPerSec = Rate(counters.writeBytes, previous->second.writeBytes, seconds);
+    }
+
+    total.cpuPercent += process.cpuPercent;
+    total.rssBytes += process.rssBytes;
+    total.readBytesPerSec += process.readBytesPerSec;
+    total.writeBytesPerSec += process.writeBytesPerSec;
+    m_processes.push_back(std::move(process));
+    current.emplace(pid, counters);
+  }
+  m_previous = std::move(current);
+
+  if (!tree.empty()) {
+    m_series.push_back(total);
+    if (m_series.size() > size_t(MaxSamples))
+      m_series.pop_front();
+  }
+  emit sampled();
+#endif
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+class QIODevice;
+
+/**
+ * Samples the resource use of the process trees started by the GUI, including the Blender
+ * instances hecl spawns, from /proc/<pid>/{stat,io}.
+ * Each tick walks /proc once to find the descendants of the current roots and computes CPU%,
+ * resident memory and storage read/write throughput from the difference to the previous
+ * sample. While any root is alive the totals are appended to a time series, which can be
+ * written out as CSV. Only Linux is supported; elsewhere isSupported() is false and nothing
+ * is sampled.
+ */
+class ProcessMonitor : public QObject {
+  Q_OBJECT
+
+public:
+  struct ProcessSample {
+    qint64 pid = 0;
+    qint64 ppid = 0;
+    QString name;
+    double cpuPercent = 0.0;
+    quint64 rssBytes = 0;
+    double readBytesPerSec = 0.0;
+    double writeBytesPerSec = 0.0;
+  };
+
+  struct Sample {
+    qint64 timestamp = 0; // msecs since epoch
+    int processes = 0;
+    double cpuPercent = 0.0; // 100 per fully used core
+    quint64 rssBytes = 0;
+    double readBytesPerSec = 0.0;
+    double writeBytesPerSec = 0.0;
+  };
+
+  static constexpr int DefaultInterval = 1000;
+  // A day at the default interval
+  static constexpr int MaxSamples = 24 * 60 * 60;
+
+  explicit ProcessMonitor(QObject* parent = Q_NULLPTR);
+
+  static bool isSupported();
+
+  // Called on every tick for the pids whose trees are sampled
+  void setRootProvider(std::function<QVector<qint64>()>&& provider) { m_rootProvider = std::move(provider); }
+  void setInterval(int msec) { m_timer.setInterval(msec); }
+
+  const std::vector<ProcessSample>& processes() const { return m_processes; }
+  const std::deque<Sample>& series() const { return m_series; }
+  void clearSeries();
+  bool writeCsv(QIODevice& out) const;
+
+signals:
+  void sampled();
+
+private:
+  struct Counters {
+    quint64 cpuTicks = 0;
+    quint64 readBytes = 0;
+    quint64 writeBytes = 0;
+  };
+
+  void sample();
+
+  std::function<QVector<qint64>()> m_rootProvider;
+  QTimer m_timer;
+  QElapsedTimer m_clock;
+  qint64 m_lastSampleMsec = -1;
+  std::unordered_map<qint64, Counters> m_previous;
+  std::vector<ProcessSample> m_processes;
+  std::deque<Sample> m_series;
+};
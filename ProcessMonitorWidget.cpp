@@ -0,0 +1,177 @@
+#include "ProcessMonitorWidget.hpp"
+
+#include <algorithm>
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QMessageBox>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QThread>
+#include <QVBoxLayout>
+
+#include "ProcessMonitor.hpp"
+
+namespace {
+QString FormatRate(double bytesPerSec) {
+  return ProcessMonitorWidget::tr("%1/s").arg(QLocale().formattedDataSize(qint64(bytesPerSec)));
+}
+
+QTableWidgetItem* NumberItem(const QString& text) {
+  auto* item = new QTableWidgetItem(text);
+  item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+  return item;
+}
+} // namespace
+
+/*
+ * CPU, memory and I/O of the recent samples as three lines, each scaled to its own maximum
+ * (CPU to all cores), so it is apparent at a glance which one a job is limited by.
+ */
+class ProcessMonitorWidget::HistoryGraph : public QWidget {
+public:
+  static constexpr int VisibleSamples = 300;
+
+  HistoryGraph(const ProcessMonitor& monitor, QWidget* parent) : QWidget(parent), m_monitor(monitor) {
+    setMinimumHeight(80);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+  }
+
+protected:
+  void paintEvent(QPaintEvent*) override {
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+    painter.setPen(palette().color(QPalette::Mid));
+    painter.drawRect(rect().adjusted(0, 0, -1, -1));
+
+    const auto& series = m_monitor.series();
+    const size_t count = std::min(series.size(), size_t(VisibleSamples));
+    if (count < 2)
+      return;
+    const size_t first = series.size() - count;
+
+    const double maxCpu = 100.0 * std::max(1, QThread::idealThreadCount());
+    double maxRss = 1.0;
+    double maxIo = 1.0;
+    for (size_t i = first; i < series.size(); ++i) {
+      maxRss = std::max(maxRss, double(series[i].rssBytes));
+      maxIo = std::max(maxIo, series[i].readBytesPerSec + series[i].writeBytesPerSec);
+    }
+
+    const QRectF area = QRectF(rect()).adjusted(2, 2, -2, -2);
+    const auto plot = [&](const QColor& color, auto value, double max) {
+      QPainterPath path;
+      for (size_t i = 0; i < count; ++i) {
+        const QPointF point(area.left() + area.width() * double(i) / double(VisibleSamples - 1),
+                            area.bottom() - area.height() * std::min(1.0, value(series[first + i]) / max));
+        if (i == 0)
+          path.moveTo(point);
+        else
+          path.lineTo(point);
+      }
+      painter.setPen(QPen(color, 1.5));
+      painter.drawPath(path);
+    };
+    painter.setRenderHint(QPainter::Antialiasing);
+    plot(QColor(220, 60, 60), [](const ProcessMonitor::Sample& s) { return s.cpuPercent; }, maxCpu);
+    plot(QColor(60, 120, 220), [](const ProcessMonitor::Sample& s) { return double(s.rssBytes); }, maxRss);
+    plot(QColor(60, 180, 60), [](const ProcessMonitor::Sample& s) { return s.readBytesPerSec + s.writeBytesPerSec; },
+         maxIo);
+  }
+
+private:
+  const ProcessMonitor& m_monitor;
+};
+
+ProcessMonitorWidget::ProcessMonitorWidget(ProcessMonitor& monitor, QWidget* parent)
+: QWidget(parent)
+, m_monitor(monitor)
+, m_summary(new QLabel(this))
+, m_graph(new HistoryGraph(monitor, this))
+, m_table(new QTableWidget(0, 6, this))
+, m_exportButton(new QPushButton(tr("Export CSV..."), this))
+, m_clearButton(new QPushButton(tr("Clear History"), this)) {
+  m_summary->setTextFormat(Qt::PlainText);
+  m_graph->setToolTip(tr("Red: CPU of all cores, blue: resident memory, green: disk read + write"));
+  m_table->setHorizontalHeaderLabels(
+      {tr("PID"), tr("Process"), tr("CPU"), tr("Memory"), tr("Read"), tr("Write")});
+  m_table->verticalHeader()->hide();
+  m_table->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
+  m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  m_table->setSelectionMode(QAbstractItemView::NoSelection);
+
+  auto* buttons = new QHBoxLayout;
+  buttons->addWidget(m_exportButton);
+  buttons->addWidget(m_clearButton);
+  buttons->addStretch();
+
+  auto* layout = new QVBoxLayout(this);
+  layout->addWidget(m_summary);
+  layout->addWidget(m_graph);
+  layout->addWidget(m_table, 1);
+  layout->addLayout(buttons);
+
+  if (!ProcessMonitor::isSupported()) {
+    m_summary->setText(tr("Resource monitoring is only available on Linux."));
+    m_graph->hide();
+    m_table->hide();
+    m_exportButton->setEnabled(false);
+    m_clearButton->setEnabled(false);
+    return;
+  }
+
+  connect(&m_monitor, &ProcessMonitor::sampled, this, &ProcessMonitorWidget::refresh);
+  connect(m_exportButton, &QPushButton::clicked, this, &ProcessMonitorWidget::exportCsv);
+  connect(m_clearButton, &QPushButton::clicked, &m_monitor, &ProcessMonitor::clearSeries);
+  refresh();
+}
+
+void ProcessMonitorWidget::refresh() {
+  const auto& processes = m_monitor.processes();
+  if (processes.empty() || m_monitor.series().empty()) {
+    m_summary->setText(tr("No jobs running."));
+  } else {
+    const ProcessMonitor::Sample& total = m_monitor.series().back();
+    m_summary->setText(tr("%1 processes  CPU %2%  Memory %3  Read %4  Write %5")
+                           .arg(total.processes)
+                           .arg(total.cpuPercent, 0, 'f', 0)
+                           .arg(QLocale().formattedDataSize(qint64(total.rssBytes)))
+                           .arg(FormatRate(total.readBytesPerSec))
+                           .arg(FormatRate(total.writeBytesPerSec)));
+  }
+
+  if (isVisible()) {
+    m_table->setRowCount(int(processes.size()));
+    for (int row = 0; row < int(processes.size()); ++row) {
+      const ProcessMonitor::ProcessSample& process = processes[size_t(row)];
+      m_table->setItem(row, 0, NumberItem(QString::number(process.pid)));
+      m_table->setItem(row, 1, new QTableWidgetItem(process.name));
+      m_table->setItem(row, 2, NumberItem(QStringLiteral("%1%").arg(process.cpuPercent, 0, 'f', 0)));
+      m_table->setItem(row, 3, NumberItem(QLocale().formattedDataSize(qint64(process.rssBytes))));
+      m_table->setItem(row, 4, NumberItem(FormatRate(process.readBytesPerSec)));
+      m_table->setItem(row, 5, NumberItem(FormatRate(process.writeBytesPerSec)));
+    }
+    m_graph->update();
+  }
+  m_exportButton->setEnabled(!m_monitor.series().empty());
+}
+
+void ProcessMonitorWidget::exportCsv() {
+  QString defaultFileName =
+      QStringLiteral("hecl-resources-") + QDateTime::currentDateTime().toString(Qt::ISODate) + QStringLiteral(".csv");
+  defaultFileName.replace(QLatin1Char(':'), QLatin1Char('-'));
+  const QString fileName =
+      QFileDialog::getSaveFileName(this, tr("Export CSV"), defaultFileName, QStringLiteral("*.csv"));
+  if (fileName.isEmpty())
+    return;
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !m_monitor.writeCsv(file))
+    QMessageBox::critical(this, tr("Export CSV"), tr("Failed to write %1").arg(fileName));
+}
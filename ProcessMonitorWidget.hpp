@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QWidget>
+
+class ProcessMonitor;
+class QLabel;
+class QPushButton;
+class QTableWidget;
+
+/* Panel showing the totals, per-process figures and recent history of a ProcessMonitor */
+class ProcessMonitorWidget : public QWidget {
+  Q_OBJECT
+
+public:
+  explicit ProcessMonitorWidget(ProcessMonitor& monitor, QWidget* parent = Q_NULLPTR);
+
+private:
+  class HistoryGraph;
+
+  void refresh();
+  void exportCsv();
+
+  ProcessMonitor& m_monitor;
+  QLabel* m_summary;
+  HistoryGraph* m_graph;
+  QTableWidget* m_table;
+  QPushButton* m_exportButton;
+  QPushButton* m_clearButton;
+};
@@ -0,0 +1,196 @@
+#include "ProgressRecognizer.hpp"
+
+#include <algorithm>
+
+#include "ConsoleProgress.hpp"
+
+namespace {
+// Long enough to cover every line hecl redraws at once
+constexpr size_t MaxRecentLines = 256;
+constexpr int MinBarWidth = 4;
+
+bool IsDigit(char16_t c) { return c >= u'0' && c <= u'9'; }
+
+bool IsBarChar(char16_t c) { return c == u'#' || c == u'=' || c == u'-' || c == u' ' || c == u'>' || c == u'.'; }
+
+struct ProgressLine {
+  size_t labelEnd = 0;
+  int percent = -1;
+  qint64 done = -1;
+  qint64 total = -1;
+  double barFill = -1.0;
+  bool hasBar = false;
+};
+
+qint64 ReadNumber(const char16_t* s, size_t begin, size_t end) {
+  qint64 value = 0;
+  for (size_t i = begin; i < end; ++i)
+    value = std::min<qint64>(value * 10 + (s[i] - u'0'), Q_INT64_C(999999999999));
+  return value;
+}
+
+/* Looks for a bar, a percentage and done/total counters; labelEnd marks where the first begins */
+ProgressLine ParseProgressLine(const char16_t* s, size_t n) {
+  ProgressLine line;
+  line.labelEnd = n;
+  for (size_t i = 0; i < n; ++i) {
+    const char16_t c = s[i];
+    if (c == u'[' && !line.hasBar) {
+      size_t j = i + 1;
+      int filled = 0;
+      while (j < n && IsBarChar(s[j])) {
+        filled += s[j] == u'#' || s[j] == u'=';
+        ++j;
+      }
+      const int width = int(j - i - 1);
+      if (j < n && s[j] == u']' && width >= MinBarWidth) {
+        line.hasBar = true;
+        line.barFill = double(filled) / width;
+        line.labelEnd = std::min(line.labelEnd, i);
+        i = j;
+      }
+    } else if (c == u'%' && line.percent < 0) {
+      size_t j = i;
+      while (j > 0 && IsDigit(s[j - 1]) && i - j < 3)
+        --j;
+      if (j < i) {
+        line.percent = std::min(int(ReadNumber(s, j, i)), 100);
+        line.labelEnd = std::min(line.labelEnd, j);
+      }
+    } else if (c == u'/' && line.total < 0 && i > 0 && IsDigit(s[i - 1]) && i + 1 < n && IsDigit(s[i + 1])) {
+      size_t b = i;
+      while (b > 0 && IsDigit(s[b - 1]))
+        --b;
+      size_t e = i + 1;
+      while (e < n && IsDigit(s[e]))
+        ++e;
+      const qint64 done = ReadNumber(s, b, i);
+      const qint64 total = ReadNumber(s, i + 1, e);
+      if (total > 0 && done <= total) {
+        line.done = done;
+        line.total = total;
+        line.labelEnd = std::min(line.labelEnd, b);
+      }
+      i = e - 1;
+    }
+  }
+  return line;
+}
+} // namespace
+
+ProgressRecognizer::ProgressRecognizer(ConsoleProgressModel& model) : m_model(model) {}
+
+void ProgressRecognizer::text(const QChar* data, int len, int format) {
+  if (m_pendingCr)
+    resolveCarriageReturn();
+  if (m_passthrough) {
+    m_downstream->text(data, len, format);
+    return;
+  }
+  const auto* chars = reinterpret_cast<const char16_t*>(data);
+  m_runs.push_back({m_line.size(), len, format});
+  m_line.insert(m_line.end(), chars, chars + len);
+}
+
+void ProgressRecognizer::carriageReturn() {
+  // CRLF (as written on Windows) ends an ordinary line; only a bare CR redraws it
+  m_pendingCr = true;
+}
+
+void ProgressRecognizer::resolveCarriageReturn() {
+  m_pendingCr = false;
+  if (!recognize(true)) {
+    forward();
+    m_downstream->carriageReturn();
+  }
+  clearLine();
+}
+
+void ProgressRecognizer::lineFeed() {
+  const bool crlf = m_pendingCr;
+  m_pendingCr = false;
+  const bool progress = recognize(false);
+  if (!progress) {
+    forward();
+    if (crlf)
+      m_downstream->carriageReturn();
+    m_downstream->lineFeed();
+  }
+  m_recent.push_back(progress);
+  if (m_recent.size() > MaxRecentLines)
+    m_recent.pop_front();
+  clearLine();
+}
+
+void ProgressRecognizer::cursorUp(int lines) {
+  // The line being drawn is about to be redrawn as well
+  if (!recognize(true))
+    forward();
+  clearLine();
+
+  int logged = 0;
+  for (int i = 0; i < lines && !m_recent.empty(); ++i) {
+    logged += !m_recent.back();
+    m_recent.pop_back();
+  }
+  if (logged > 0)
+    m_downstream->cursorUp(logged);
+}
+
+void ProgressRecognizer::flushPending() {
+  if (m_passthrough || m_line.empty())
+    return;
+  // Text without a bar opener or a percent sign can't become a progress line
+  if (std::none_of(m_line.begin(), m_line.end(), [](char16_t c) { return c == u'[' || c == u'%'; })) {
+    forward();
+    m_passthrough = true;
+  }
+}
+
+void ProgressRecognizer::finish() {
+  if (m_pendingCr)
+    resolveCarriageReturn();
+  forward();
+  clearLine();
+  m_recent.clear();
+}
+
+void ProgressRecognizer::reset() {
+  clearLine();
+  m_recent.clear();
+}
+
+bool ProgressRecognizer::recognize(bool overwritten) {
+  if (m_passthrough || m_line.empty())
+    return false;
+  const ProgressLine line = ParseProgressLine(m_line.data(), m_line.size());
+  if (!line.hasBar && !(overwritten && line.percent >= 0))
+    return false;
+
+  size_t labelBegin = 0;
+  size_t labelEnd = line.labelEnd;
+  while (labelBegin < labelEnd && (m_line[labelBegin] == u' ' || m_line[labelBegin] == u'\t'))
+    ++labelBegin;
+  while (labelEnd > labelBegin && (m_line[labelEnd - 1] == u' ' || m_line[labelEnd - 1] == u'('))
+    --labelEnd;
+  const QString label(reinterpret_cast<const QChar*>(m_line.data() + labelBegin), int(labelEnd - labelBegin));
+  m_model.update(label, line.percent, line.done, line.total, line.barFill);
+  return true;
+}
+
+void ProgressRecognizer::forward() {
+  if (!m_passthrough) {
+    const auto* chars = reinterpret_cast<const QChar*>(m_line.data());
+    for (const Run& run : m_runs)
+      m_downstream->text(chars + run.begin, run.len, run.format);
+  }
+  m_line.clear();
+  m_runs.clear();
+}
+
+void ProgressRecognizer::clearLine() {
+  m_line.clear();
+  m_runs.clear();
+  m_passthrough = false;
+  m_pendingCr = false;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "TerminalParser.hpp"
+
+class ConsoleProgressModel;
+
+/**
+ * Sits between TerminalParser and the console log and takes hecl's progress lines out of the
+ * stream. A line counts as progress when it draws a bar ("[####----]") or reports a percentage
+ * and is then overwritten with a carriage return; such lines update the progress model instead
+ * of the log. A carriage return directly followed by a line feed ends an ordinary line, so the
+ * decision waits for whatever comes after it. Cursor-up sequences that redraw progress lines
+ * are adjusted so only lines that actually reached the log are rewound.
+ */
+class ProgressRecognizer : public TerminalParser::Sink {
+public:
+  explicit ProgressRecognizer(ConsoleProgressModel& model);
+
+  void setDownstream(TerminalParser::Sink* downstream) { m_downstream = downstream; }
+
+  void text(const QChar* data, int len, int format) override;
+  void carriageReturn() override;
+  void lineFeed() override;
+  void cursorUp(int lines) override;
+
+  // Forwards a partial line once it can no longer turn out to be progress
+  void flushPending();
+  // Forwards everything held back, e.g. when the process exits
+  void finish();
+  void reset();
+
+private:
+  struct Run {
+    size_t begin;
+    int len;
+    int format;
+  };
+
+  bool recognize(bool overwritten);
+  void resolveCarriageReturn();
+  void forward();
+  void clearLine();
+
+  TerminalParser::Sink* m_downstream = nullptr;
+  ConsoleProgressModel& m_model;
+  std::vector<char16_t> m_line;
+  std::vector<Run> m_runs;
+  bool m_passthrough = false;
+  bool m_pendingCr = false;
+  // Most recent finished lines, true for those kept out of the log
+  std::deque<bool> m_recent;
+};
@@ -0,0 +1,177 @@
+#include "SessionLog.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+
+#include <quagzipfile.h>
+
+namespace {
+// Above this the writer is woken right away instead of at its next interval
+constexpr qint64 WakeThreshold = 256 * 1024;
+constexpr qint64 CompressChunkSize = 64 * 1024;
+
+// Logs still being written by some SessionLog, which rotation must leave alone
+std::mutex ActiveMutex;
+QSet<QString> ActivePaths;
+// Each SessionLog rotates from its own writer thread; only one may compress and prune at a time
+std::mutex RotateMutex;
+
+bool CompressFile(const QString& path) {
+  QFile in(path);
+  if (!in.open(QIODevice::ReadOnly))
+    return false;
+  const QString gzPath = path + QStringLiteral(".gz");
+  QuaGzipFile out(gzPath);
+  if (!out.open(QIODevice::WriteOnly))
+    return false;
+  QByteArray chunk;
+  while (!(chunk = in.read(CompressChunkSize)).isEmpty()) {
+    if (out.write(chunk) != chunk.size()) {
+      out.close();
+      QFile::remove(gzPath);
+      return false;
+    }
+  }
+  out.close();
+  in.close();
+  return in.remove();
+}
+} // namespace
+
+SessionLog::SessionLog() : m_writer(&SessionLog::writerMain, this) {}
+
+SessionLog::~SessionLog() {
+  end();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_one();
+  m_writer.join();
+}
+
+QString SessionLog::logDir(const QString& workingDir) { return workingDir + QStringLiteral("/logs"); }
+
+void SessionLog::begin(const QString& workingDir, const QString& name) {
+  end();
+  const QString dir = logDir(workingDir);
+  if (!QDir().mkpath(dir)) {
+    qWarning() << "Unable to create log directory" << dir;
+    return;
+  }
+  // Timestamp first so the archive sorts chronologically by name
+  m_path = QDir(dir).absoluteFilePath(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss")) +
+                                      QLatin1Char{'-'} + name + QStringLiteral(".log"));
+  {
+    std::lock_guard<std::mutex> lock(ActiveMutex);
+    ActivePaths.insert(m_path);
+  }
+  post({Op::Open, m_path, {}});
+  const QByteArray header = QStringLiteral("==== %1 started %2 ====\n")
+                                .arg(name, QDateTime::currentDateTime().toString(Qt::ISODate))
+                                .toUtf8();
+  append(header.constData(), header.size());
+}
+
+void SessionLog::append(const char* data, qint64 len) {
+  if (m_path.isEmpty() || len <= 0)
+    return;
+  bool wake;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_queue.empty() || m_queue.back().op != Op::Write)
+      m_queue.push_back({Op::Write, {}, {}});
+    m_queue.back().data.append(data, int(len));
+    m_buffered += len;
+    wake = m_buffered >= WakeThreshold;
+  }
+  if (wake)
+    m_wake.notify_one();
+}
+
+void SessionLog::end() {
+  if (m_path.isEmpty())
+    return;
+  post({Op::Close, std::exchange(m_path, QString()), {}});
+}
+
+void SessionLog::post(Command&& command) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(std::move(command));
+  }
+  m_wake.notify_one();
+}
+
+void SessionLog::writerMain() {
+  QFile file;
+  std::deque<Command> batch;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait_for(lock, std::chrono::milliseconds(FlushInterval), [this] {
+        return m_stop || m_buffered >= WakeThreshold ||
+               std::any_of(m_queue.begin(), m_queue.end(), [](const Command& c) { return c.op != Op::Write; });
+      });
+      batch.swap(m_queue);
+      m_buffered = 0;
+      if (batch.empty() && m_stop)
+        break;
+    }
+
+    for (Command& command : batch) {
+      switch (command.op) {
+      case Op::Open:
+        file.close();
+        rotate(QFileInfo(command.path).absolutePath());
+        file.setFileName(command.path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+          qWarning() << "Unable to open session log" << command.path << file.errorString();
+        break;
+      case Op::Write:
+        if (file.isOpen())
+          file.write(command.data);
+        break;
+      case Op::Close: {
+        file.close();
+        std::lock_guard<std::mutex> lock(ActiveMutex);
+        ActivePaths.remove(command.path);
+        break;
+      }
+      }
+    }
+    batch.clear();
+    // Hand the data to the OS now; it then survives the process going away
+    if (file.isOpen())
+      file.flush();
+  }
+  file.close();
+}
+
+void SessionLog::rotate(const QString& dir) {
+  std::lock_guard<std::mutex> rotateLock(RotateMutex);
+  const QDir logs(dir); // absolute, like the paths in ActivePaths
+  // Paths are registered before their file is created, so snapshotting after listing catches every active one
+  const QStringList logNames = logs.entryList({QStringLiteral("*.log")}, QDir::Files, QDir::Name);
+  QSet<QString> active;
+  {
+    std::lock_guard<std::mutex> lock(ActiveMutex);
+    active = ActivePaths;
+  }
+  for (const QString& name : logNames) {
+    if (!active.contains(logs.filePath(name)) && !CompressFile(logs.filePath(name)))
+      qWarning() << "Unable to compress session log" << logs.filePath(name);
+  }
+
+  const QStringList archived = logs.entryList({QStringLiteral("*.log.gz")}, QDir::Files, QDir::Name);
+  for (int i = 0; i < archived.size() - MaxArchivedSessions; ++i)
+    QFile::remove(logs.filePath(archived[i]));
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * Records the raw output of every process session to <working dir>/logs as it arrives.
+ * append() only copies into a buffer; a writer thread moves it to the file at least every
+ * FlushInterval milliseconds, so the log survives a GUI crash part way through a session.
+ * Starting a session gzips the plain logs in the directory that no SessionLog is writing,
+ * including one left behind by a crash, and keeps the newest MaxArchivedSessions of them.
+ * Several sessions may be recorded at once, e.g. one per packaging shard.
+ */
+class SessionLog {
+public:
+  static constexpr int MaxArchivedSessions = 64;
+  static constexpr int FlushInterval = 250;
+
+  SessionLog();
+  ~SessionLog();
+  SessionLog(const SessionLog&) = delete;
+  SessionLog& operator=(const SessionLog&) = delete;
+
+  static QString logDir(const QString& workingDir);
+
+  // Ends the current session, if any, and starts writing to a new file named after the session
+  void begin(const QString& workingDir, const QString& name);
+  void append(const char* data, qint64 len);
+  void end();
+
+  bool isActive() const { return !m_path.isEmpty(); }
+  QString currentPath() const { return m_path; }
+
+private:
+  enum class Op { Open, Write, Close };
+  struct Command {
+    Op op;
+    QString path;
+    QByteArray data;
+  };
+
+  void post(Command&& command);
+  void writerMain();
+  static void rotate(const QString& dir);
+
+  QString m_path;
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::deque<Command> m_queue;
+  qint64 m_buffered = 0;
+  bool m_stop = false;
+  std::thread m_writer;
+};
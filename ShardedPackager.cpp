@@ -0,0 +1,233 @@
+#include "ShardedPackager.hpp"
+
+#include <algorithm>
+#include <deque>
+
+#include <QFile>
+#include <QIODevice>
+
+#include "ConsoleProgress.hpp"
+#include "PackageStateTracker.hpp"
+#include "ProgressRecognizer.hpp"
+#include "SessionLog.hpp"
+#include "TerminalParser.hpp"
+#include "Utf8StreamDecoder.hpp"
+
+namespace {
+// Keeps the last lines a shard printed, as plain text
+class TailSink : public TerminalParser::Sink {
+public:
+  void text(const QChar* data, int len, int) override { m_line.append(data, len); }
+  void carriageReturn() override { m_line.clear(); }
+  void lineFeed() override {
+    m_lines.push_back(std::move(m_line));
+    m_line.clear();
+    if (m_lines.size() > size_t(ShardedPackager::TailLines))
+      m_lines.pop_front();
+  }
+  void cursorUp(int lines) override {
+    for (int i = 0; i < lines && !m_lines.empty(); ++i)
+      m_lines.pop_back();
+    m_line.clear();
+  }
+
+  QStringList lines() const {
+    QStringList out;
+    for (const QString& line : m_lines)
+      out.push_back(line);
+    if (!m_line.isEmpty())
+      out.push_back(m_line);
+    return out;
+  }
+
+private:
+  std::deque<QString> m_lines;
+  QString m_line;
+};
+} // namespace
+
+struct ShardedPackager::Shard {
+  enum class State { Pending, Running, Done, Failed };
+
+  explicit Shard(const QString& name) : name(name), recognizer(progress) { recognizer.setDownstream(&tail); }
+
+  QString name;
+  State state = State::Pending;
+  JobId job = 0;
+  Utf8StreamDecoder decoder;
+  TerminalParser parser;
+  ConsoleProgressModel progress;
+  ProgressRecognizer recognizer;
+  TailSink tail;
+  SessionLog log;
+};
+
+ShardedPackager::ShardedPackager(JobRunner& jobs, ConsoleProgressModel& progress, QObject* parent)
+: QObject(parent), m_jobs(jobs), m_progress(progress), m_retry(this) {
+  m_retry.setSingleShot(true);
+  m_retry.setInterval(2000);
+  connect(&m_retry, &QTimer::timeout, this, &ShardedPackager::schedule);
+  connect(&m_jobs, &JobRunner::jobOutput, this, &ShardedPackager::onJobOutput);
+  connect(&m_jobs, &JobRunner::jobFinished, this, &ShardedPackager::onJobFinished);
+}
+
+ShardedPackager::~ShardedPackager() = default;
+
+QStringList ShardedPackager::worldShards() {
+  QStringList shards;
+  for (const QString& pak : PackageStateTracker::skExpectedPaks) {
+    if (pak.startsWith(QStringLiteral("metroid"), Qt::CaseInsensitive))
+      shards.push_back(pak.chopped(5)); // .upak
+  }
+  return shards;
+}
+
+int ShardedPackager::concurrencyFor(int cores, quint64 memoryBytes) {
+  const int byCores = std::max(1, cores / CoresPerShard);
+  const int byMemory = int(std::max<quint64>(1, memoryBytes / MemoryPerShard));
+  return std::min(byCores, byMemory);
+}
+
+quint64 ShardedPackager::availableMemory(quint64 fallback) {
+#if __linux__
+  QFile meminfo(QStringLiteral("/proc/meminfo"));
+  if (meminfo.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    for (QByteArray line = meminfo.readLine(); !line.isEmpty(); line = meminfo.readLine()) {
+      if (line.startsWith("MemAvailable:"))
+        return line.mid(13).trimmed().split(' ').front().toULongLong() * 1024;
+    }
+  }
+#endif
+  return fallback;
+}
+
+void ShardedPackager::start(const QString& workingDir, const QString& heclPath, const QStringList& shards,
+                            int concurrency, bool recordLogs) {
+  if (m_running)
+    return;
+  m_shards.clear();
+  for (const QString& name : shards)
+    m_shards.push_back(std::make_unique<Shard>(name));
+  m_workingDir = workingDir;
+  m_heclPath = heclPath;
+  m_concurrency = std::max(1, concurrency);
+  m_recordLogs = recordLogs;
+  m_running = true;
+  m_failed = false;
+  m_progress.reset();
+  schedule();
+}
+
+void ShardedPackager::cancel() {
+  if (!m_running)
+    return;
+  m_retry.stop();
+  // A failed shard stops the others from being scheduled; cancelling them ends the run
+  m_failed = true;
+  for (auto& shard : m_shards) {
+    if (shard->state == Shard::State::Pending)
+      shard->state = Shard::State::Failed;
+  }
+  for (auto& shard : m_shards) {
+    if (shard->state == Shard::State::Running)
+      m_jobs.cancel(shard->job);
+  }
+  schedule();
+}
+
+void ShardedPackager::schedule() {
+  if (!m_running)
+    return;
+
+  int running = 0;
+  int pending = 0;
+  for (const auto& shard : m_shards) {
+    running += shard->state == Shard::State::Running;
+    pending += shard->state == Shard::State::Pending;
+  }
+
+  if (!m_failed) {
+    for (auto& shard : m_shards) {
+      if (pending == 0 || running >= m_concurrency)
+        break;
+      if (shard->state != Shard::State::Pending)
+        continue;
+      // The first shard always runs; more only while there is room for another Blender
+      if (running > 0 && availableMemory(MemoryPerShard) < MemoryPerShard) {
+        m_retry.start();
+        break;
+      }
+
+      const QString path = QStringLiteral("MP1/") + shard->name;
+      const JobSpec spec{JobKind::Package,
+                         QStringLiteral("package-") + shard->name,
+                         m_heclPath,
+                         {QStringLiteral("package"), path, QStringLiteral("-y"), QStringLiteral("-g")},
+                         m_workingDir,
+                         {}};
+      if (m_recordLogs)
+        shard->log.begin(m_workingDir, spec.name);
+      shard->state = Shard::State::Running;
+      shard->job = m_jobs.start(spec);
+      ++running;
+      --pending;
+      emit shardStarted(shard->name, shard->log.currentPath());
+    }
+  }
+
+  if (running == 0 && (pending == 0 || m_failed)) {
+    m_running = false;
+    m_retry.stop();
+    m_progress.reset();
+    emit finished(!m_failed);
+  }
+}
+
+ShardedPackager::Shard* ShardedPackager::shardForJob(JobId id) {
+  for (auto& shard : m_shards) {
+    if (shard->state == Shard::State::Running && shard->job == id)
+      return shard.get();
+  }
+  return nullptr;
+}
+
+void ShardedPackager::onJobOutput(JobId id, QIODevice* output) {
+  Shard* shard = shardForJob(id);
+  if (!shard)
+    return;
+  const QByteArray data = output->readAll();
+  shard->log.append(data.constData(), data.size());
+  int len = 0;
+  const QChar* text = shard->decoder.decode(data.constData(), data.size(), &len);
+  shard->parser.feed(text, len, shard->recognizer);
+  shard->recognizer.flushPending();
+  publishProgress();
+}
+
+void ShardedPackager::onJobFinished(JobId id, const JobResult& result) {
+  Shard* shard = shardForJob(id);
+  if (!shard)
+    return;
+  shard->recognizer.finish();
+  shard->log.end();
+  shard->state = result.succeeded() ? Shard::State::Done : Shard::State::Failed;
+  if (!result.succeeded())
+    m_failed = true;
+  emit shardFinished(shard->name, result, shard->tail.lines());
+  publishProgress();
+  schedule();
+}
+
+void ShardedPackager::publishProgress() {
+  if (m_shards.empty())
+    return;
+  double sum = 0.0;
+  for (const auto& shard : m_shards) {
+    if (shard->state == Shard::State::Done)
+      sum += 1.0;
+    else if (shard->state == Shard::State::Running)
+      sum += std::max(0.0, shard->progress.progress().fraction);
+  }
+  m_progress.update(tr("Packaging worlds"), int(sum * 100.0 / double(m_shards.size())), -1, -1, -1.0);
+  m_progress.publish();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+
+#include "JobRunner.hpp"
+
+class ConsoleProgressModel;
+
+/**
+ * Packages independent paks as concurrent `hecl package MP1/<pak>` jobs.
+ * At most concurrency() shards run at once, sized from the core count and physical memory.
+ * Before each further shard starts the currently available memory is checked as well, so a
+ * machine that is already under pressure keeps fewer Blender instances alive.
+ * Every shard's raw output goes to its own session log; its progress lines are recognized
+ * separately and merged into one overall progress, and the last lines it printed are kept
+ * for reporting a failure.
+ */
+class ShardedPackager : public QObject {
+  Q_OBJECT
+
+public:
+  // Working set budgeted for one hecl process together with the Blender instance it drives
+  static constexpr quint64 MemoryPerShard = 2ULL * 1024 * 1024 * 1024;
+  static constexpr int CoresPerShard = 2;
+  static constexpr int TailLines = 20;
+
+  ShardedPackager(JobRunner& jobs, ConsoleProgressModel& progress, QObject* parent = Q_NULLPTR);
+  ~ShardedPackager() override;
+
+  // World paks that can be cooked independently of each other
+  static QStringList worldShards();
+  static int concurrencyFor(int cores, quint64 memoryBytes);
+  // MemAvailable where the system reports it, otherwise `fallback`
+  static quint64 availableMemory(quint64 fallback);
+
+  void start(const QString& workingDir, const QString& heclPath, const QStringList& shards, int concurrency,
+             bool recordLogs);
+  void cancel();
+  bool isRunning() const { return m_running; }
+  int concurrency() const { return m_concurrency; }
+
+signals:
+  void shardStarted(const QString& name, const QString& logPath);
+  void shardFinished(const QString& name, const JobResult& result, const QStringList& tail);
+  // Emitted once every shard has ended; success only if all of them did
+  void finished(bool success);
+
+private:
+  struct Shard;
+
+  void schedule();
+  void onJobOutput(JobId id, QIODevice* output);
+  void onJobFinished(JobId id, const JobResult& result);
+  void publishProgress();
+  Shard* shardForJob(JobId id);
+
+  JobRunner& m_jobs;
+  ConsoleProgressModel& m_progress;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+  QString m_workingDir;
+  QString m_heclPath;
+  int m_concurrency = 1;
+  bool m_recordLogs = true;
+  bool m_running = false;
+  bool m_failed = false;
+  QTimer m_retry;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+/**
+ * Lock-free byte ring for exactly one producer thread and one consumer thread.
+ * Each write is published with a single release store, so a record written in one call is
+ * never seen partially by the consumer.
+ */
+class SpscRing {
+public:
+  explicit SpscRing(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity)
+      size <<= 1;
+    m_buf.resize(size);
+    m_mask = size - 1;
+  }
+
+  size_t capacity() const { return m_buf.size(); }
+
+  // Producer side
+  size_t writeAvailable() const {
+    return m_buf.size() - (m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_acquire));
+  }
+
+  bool tryWrite(const void* a, size_t aLen, const void* b = nullptr, size_t bLen = 0) {
+    if (writeAvailable() < aLen + bLen)
+      return false;
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    copyIn(head, a, aLen);
+    copyIn(head + aLen, b, bLen);
+    m_head.store(head + aLen + bLen, std::memory_order_release);
+    return true;
+  }
+
+  size_t writeSome(const void* data, size_t len) {
+    len = std::min(len, writeAvailable());
+    tryWrite(data, len);
+    return len;
+  }
+
+  // Consumer side
+  size_t readAvailable() const {
+    return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_relaxed);
+  }
+
+  // len must not exceed readAvailable()
+  void read(void* dst, size_t len) {
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    const size_t start = tail & m_mask;
+    const size_t first = std::min(len, m_buf.size() - start);
+    std::memcpy(dst, m_buf.data() + start, first);
+    std::memcpy(static_cast<char*>(dst) + first, m_buf.data(), len - first);
+    m_tail.store(tail + len, std::memory_order_release);
+  }
+
+  // Only while neither side is running
+  void reset() {
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  void copyIn(size_t pos, const void* src, size_t len) {
+    if (len == 0)
+      return;
+    const size_t start = pos & m_mask;
+    const size_t first = std::min(len, m_buf.size() - start);
+    std::memcpy(m_buf.data() + start, src, first);
+    std::memcpy(m_buf.data(), static_cast<const char*>(src) + first, len - first);
+  }
+
+  std::vector<char> m_buf;
+  size_t m_mask = 0;
+  alignas(64) std::atomic<size_t> m_head{0}; // advanced by the producer
+  alignas(64) std::atomic<size_t> m_tail{0}; // advanced by the consumer
+};
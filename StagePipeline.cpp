@@ -0,0 +1,128 @@
+#include "StagePipeline.hpp"
+
+#include <utility>
+
+#include "PackageStateTracker.hpp"
+
+StagePipeline::StagePipeline(JobRunner& jobs, PackageStateTracker& state, QObject* parent)
+: QObject(parent), m_jobs(jobs), m_state(state) {
+  // Queued so everyone else has handled the end of a stage before the next one starts
+  connect(&m_jobs, &JobRunner::jobFinished, this, &StagePipeline::onJobFinished, Qt::QueuedConnection);
+}
+
+JobSpec StagePipeline::extractJob(const QString& workingDir, const QString& heclPath, const QString& imagePath) {
+  return {JobKind::Extract,
+          QStringLiteral("extract"),
+          heclPath,
+          {QStringLiteral("extract"), QStringLiteral("-y"), QStringLiteral("-g"), QStringLiteral("-o"), workingDir,
+           imagePath},
+          workingDir,
+          {}};
+}
+
+JobSpec StagePipeline::packageJob(const QString& workingDir, const QString& heclPath) {
+  return {JobKind::Package,
+          QStringLiteral("package"),
+          heclPath,
+          {QStringLiteral("package"), QStringLiteral("MP1"), QStringLiteral("-y"), QStringLiteral("-g")},
+          workingDir,
+          {}};
+}
+
+JobSpec StagePipeline::launchJob(const QString& workingDir, const QString& urdePath, const QStringList& arguments) {
+  return {JobKind::Launch, QStringLiteral("launch"), urdePath, arguments, workingDir, {}};
+}
+
+void StagePipeline::start(const Config& config) {
+  if (m_running)
+    return;
+  m_config = config;
+  m_running = true;
+  m_job = 0;
+  m_stage = Stage::Extract;
+  advance();
+}
+
+void StagePipeline::cancel() {
+  if (!m_running)
+    return;
+  const JobId job = std::exchange(m_job, 0);
+  m_jobs.cancel(job);
+  end(false, tr("Cancelled."));
+}
+
+void StagePipeline::advance() {
+  m_state.refresh();
+
+  // m_stage is the first stage that has neither run nor been skipped yet
+  if (m_stage == Stage::Extract) {
+    if (!m_state.isExtracted()) {
+      if (m_config.imagePath.isEmpty())
+        end(false, tr("A disc image is needed to extract."));
+      else
+        runStage(Stage::Extract, extractJob(m_config.workingDir, m_config.heclPath, m_config.imagePath));
+      return;
+    }
+    emit stageSkipped(Stage::Extract);
+    m_stage = Stage::Package;
+  }
+
+  if (m_stage == Stage::Package) {
+    if (!m_state.isPackageComplete()) {
+      runStage(Stage::Package, packageJob(m_config.workingDir, m_config.heclPath));
+      return;
+    }
+    emit stageSkipped(Stage::Package);
+    m_stage = Stage::Launch;
+  }
+
+  if (!m_config.launch) {
+    end(true, tr("Package complete."));
+    return;
+  }
+  runStage(Stage::Launch, launchJob(m_config.workingDir, m_config.urdePath, m_config.launchArguments));
+  // Launching is the last step; the game runs as an ordinary job from here on
+  m_job = 0;
+  end(true, {});
+}
+
+void StagePipeline::runStage(Stage stage, const JobSpec& spec) {
+  m_stage = stage;
+  m_job = m_jobs.start(spec);
+  emit stageStarted(stage, m_job);
+}
+
+void StagePipeline::onJobFinished(JobId id, const JobResult& result) {
+  if (!m_running || id != m_job)
+    return;
+  m_job = 0;
+  if (!result.succeeded()) {
+    const QString name = m_stage == Stage::Extract ? tr("Extract") : tr("Package");
+    end(false, result.state == JobResult::State::FailedToStart
+                   ? tr("%1 failed to start.").arg(name)
+                   : tr("%1 failed with exit code %2.").arg(name).arg(result.exitCode));
+    return;
+  }
+  m_state.refresh();
+  if (m_stage == Stage::Extract) {
+    if (!m_state.isExtracted()) {
+      end(false, tr("Extract finished but produced no version.yaml."));
+      return;
+    }
+    m_stage = Stage::Package;
+  } else {
+    if (!m_state.isPackageComplete()) {
+      end(false, tr("Package finished but %1 of %2 paks are missing.")
+                     .arg(m_state.expectedPaks() - m_state.presentPaks())
+                     .arg(m_state.expectedPaks()));
+      return;
+    }
+    m_stage = Stage::Launch;
+  }
+  advance();
+}
+
+void StagePipeline::end(bool success, const QString& message) {
+  m_running = false;
+  emit finished(success, message);
+}
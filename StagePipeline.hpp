@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+
+#include "JobRunner.hpp"
+
+class PackageStateTracker;
+
+/**
+ * Runs extract, package and launch back to back.
+ * Before each stage the tracked outputs are rescanned; a stage whose outputs are already
+ * complete (version.yaml for extract, every pak for package) is skipped. The next stage is
+ * started as soon as the previous job exits with 0. Any other result ends the pipeline.
+ * The pipeline is done once the launch job has started; that job then runs on its own.
+ */
+class StagePipeline : public QObject {
+  Q_OBJECT
+
+public:
+  enum class Stage { Extract, Package, Launch };
+  Q_ENUM(Stage)
+
+  struct Config {
+    QString workingDir;
+    QString heclPath;
+    QString urdePath;
+    QString imagePath; // only needed if extraction hasn't happened yet
+    QStringList launchArguments;
+    bool launch = true;
+  };
+
+  StagePipeline(JobRunner& jobs, PackageStateTracker& state, QObject* parent = Q_NULLPTR);
+
+  static JobSpec extractJob(const QString& workingDir, const QString& heclPath, const QString& imagePath);
+  static JobSpec packageJob(const QString& workingDir, const QString& heclPath);
+  static JobSpec launchJob(const QString& workingDir, const QString& urdePath, const QStringList& arguments);
+
+  // Emits finished() right away if there is nothing to do or the first stage can't run
+  void start(const Config& config);
+  void cancel();
+  bool isRunning() const { return m_running; }
+
+signals:
+  void stageSkipped(StagePipeline::Stage stage);
+  void stageStarted(StagePipeline::Stage stage, JobId job);
+  void finished(bool success, const QString& message);
+
+private:
+  void advance();
+  void runStage(Stage stage, const JobSpec& spec);
+  void onJobFinished(JobId id, const JobResult& result);
+  void end(bool success, const QString& message);
+
+  JobRunner& m_jobs;
+  PackageStateTracker& m_state;
+  Config m_config;
+  bool m_running = false;
+  JobId m_job = 0;
+  Stage m_stage = Stage::Extract;
+};
@@ -0,0 +1,169 @@
+#include "StagedInstall.hpp"
+
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QFile>
+#include <QThread>
+
+#include <quazip.h>
+
+#include "ExtractZip.hpp"
+
+#if _WIN32
+#include <Windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const QString StagingName = QStringLiteral(".hecl-gui-staging");
+static const QString BackupName = QStringLiteral(".hecl-gui-previous");
+
+static bool SyncFile(const QString& path) {
+#if _WIN32
+  QFile file(path);
+  if (!file.open(QIODevice::ReadWrite))
+    return false;
+  return ::FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle()))) != FALSE;
+#else
+  const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  const bool ok = ::fsync(fd) == 0;
+  ::close(fd);
+  return ok;
+#endif
+}
+
+static void SyncDir(const QString& path) {
+#if !_WIN32
+  // Makes the renames themselves durable; not supported (or needed) on Windows
+  const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+#else
+  Q_UNUSED(path)
+#endif
+}
+
+StagedInstall::StagedInstall(const QString& targetDir)
+: m_target(targetDir)
+, m_staging(m_target.absoluteFilePath(StagingName))
+, m_backup(m_target.absoluteFilePath(BackupName)) {
+  // Leftovers from an interrupted install are stale by definition
+  m_staging.removeRecursively();
+  m_valid = m_target.mkpath(StagingName);
+}
+
+StagedInstall::~StagedInstall() {
+  if (m_worker)
+    m_worker->wait();
+  m_staging.removeRecursively();
+}
+
+bool StagedInstall::commitArchive(QuaZip& zip, bool extracted, QStringList* rewritten, QString* error) {
+  const QString target = m_target.absolutePath();
+  const bool staged = extracted ? ExtractZip::applyPermissions(zip, stagingDir())
+                                : ExtractZip::extractDirIncremental(zip, target, rewritten, nullptr, stagingDir());
+  if (!staged || !commit(error))
+    return false;
+  ExtractZip::writeManifest(zip, target);
+  return true;
+}
+
+namespace {
+class ArchiveThread : public QThread {
+public:
+  explicit ArchiveThread(std::function<void()>&& work) : m_work(std::move(work)) {}
+
+protected:
+  void run() override { m_work(); }
+
+private:
+  std::function<void()> m_work;
+};
+
+struct ArchiveResult {
+  bool ok = false;
+  QStringList rewritten;
+  QString error;
+};
+} // namespace
+
+void StagedInstall::commitArchiveAsync(const QString& archivePath, bool extracted, QObject* context,
+                                       ArchiveHandler&& done) {
+  if (m_worker)
+    m_worker->wait();
+
+  // Written by the worker before finished() is emitted, read only once it has been delivered
+  auto result = std::make_shared<ArchiveResult>();
+  m_worker = std::make_unique<ArchiveThread>([this, archivePath, extracted, result] {
+    QuaZip zip(archivePath);
+    if (zip.open(QuaZip::mdUnzip)) {
+      result->ok = commitArchive(zip, extracted, &result->rewritten, &result->error);
+      zip.close();
+    } else {
+      result->error = QCoreApplication::translate("StagedInstall", "Unable to open zip archive.");
+    }
+    QFile::remove(archivePath);
+  });
+  QObject::connect(m_worker.get(), &QThread::finished, context,
+                   [result, done = std::move(done)] { done(result->ok, result->rewritten, result->error); },
+                   Qt::QueuedConnection);
+  m_worker->start();
+}
+
+bool StagedInstall::commit(QString* error) {
+  const auto fail = [&](const QString& message) {
+    rollback();
+    if (error)
+      *error = message;
+    return false;
+  };
+
+  if (!m_valid)
+    return fail(QCoreApplication::translate("StagedInstall", "Unable to create %1").arg(stagingDir()));
+
+  QStringList files;
+  QDirIterator it(stagingDir(), QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+  while (it.hasNext())
+    files.push_back(m_staging.relativeFilePath(it.next()));
+
+  // Flush everything in one batch before the first rename, so a crash can't expose a torn file
+  for (const QString& rel : files)
+    if (!SyncFile(m_staging.absoluteFilePath(rel)))
+      return fail(QCoreApplication::translate("StagedInstall", "Unable to flush %1").arg(rel));
+  SyncDir(stagingDir());
+
+  // Only the previous set is kept as a backup; files still in use may refuse deletion, which is harmless
+  m_backup.removeRecursively();
+  m_journal.clear();
+  for (const QString& rel : files) {
+    const QString target = m_target.absoluteFilePath(rel);
+    if (QFileInfo::exists(target)) {
+      const QString backup = m_backup.absoluteFilePath(rel);
+      QFile::remove(backup);
+      if (!QDir().mkpath(QFileInfo(backup).absolutePath()) || !QFile::rename(target, backup))
+        return fail(QCoreApplication::translate("StagedInstall", "Unable to replace %1").arg(target));
+      m_journal.emplace_back(target, backup);
+    }
+    if (!QDir().mkpath(QFileInfo(target).absolutePath()) || !QFile::rename(m_staging.absoluteFilePath(rel), target))
+      return fail(QCoreApplication::translate("StagedInstall", "Unable to install %1").arg(target));
+    m_journal.emplace_back(m_staging.absoluteFilePath(rel), target);
+  }
+
+  SyncDir(m_target.absolutePath());
+  m_journal.clear();
+  return true;
+}
+
+void StagedInstall::rollback() {
+  for (auto it = m_journal.rbegin(); it != m_journal.rend(); ++it) {
+    QFile::remove(it->first);
+    QFile::rename(it->second, it->first);
+  }
+  m_journal.clear();
+}
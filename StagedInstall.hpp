@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QDir>
+#include <QString>
+#include <QStringList>
+
+class QObject;
+class QThread;
+class QuaZip;
+
+/**
+ * Installs a set of files into a directory as one unit.
+ * Files are first written under stagingDir(); commit() flushes them all to disk, then renames
+ * each one over its target, moving the file it replaces into a backup directory. If any rename
+ * fails, every move done so far is undone so the previous set stays intact.
+ * Renaming works even while the old binaries are running.
+ */
+class StagedInstall {
+public:
+  explicit StagedInstall(const QString& targetDir);
+  ~StagedInstall();
+  StagedInstall(const StagedInstall&) = delete;
+  StagedInstall& operator=(const StagedInstall&) = delete;
+
+  bool isValid() const { return m_valid; }
+  QString stagingDir() const { return m_staging.absolutePath(); }
+  bool commit(QString* error = nullptr);
+  // Stages a downloaded release archive, or finishes one extracted while streaming, commits
+  // it and records its manifest. A false return with an empty error means extraction failed.
+  bool commitArchive(QuaZip& zip, bool extracted, QStringList* rewritten = nullptr, QString* error = nullptr);
+
+  using ArchiveHandler = std::function<void(bool ok, const QStringList& rewritten, const QString& error)>;
+  // commitArchive() for the archive at archivePath on a worker thread, removing the archive
+  // afterwards. done is queued to context's thread and dropped if context is gone by then;
+  // destroying the StagedInstall waits for the worker.
+  void commitArchiveAsync(const QString& archivePath, bool extracted, QObject* context, ArchiveHandler&& done);
+
+private:
+  void rollback();
+
+  QDir m_target;
+  QDir m_staging;
+  QDir m_backup;
+  bool m_valid = false;
+  // (from, to) renames applied by commit(), in order
+  std::vector<std::pair<QString, QString>> m_journal;
+  std::unique_ptr<QThread> m_worker;
+};
@@ -29,6 +29,7 @@ public:
   QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
   QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
   bool isBlenderVersionOk() const;
+  quint64 memorySize() const { return m_memorySize; }
   void updateFreeDiskSpace(const QString& path);
 };
 
@@ -0,0 +1,88 @@
+#include "TermFormatTable.hpp"
+
+#include <QFontDatabase>
+
+TermFormatTable::TermFormatTable() { intern(TermFormat{}); }
+
+int TermFormatTable::intern(const TermFormat& state) {
+  const quint64 key = state.key();
+  auto it = m_index.constFind(key);
+  if (it != m_index.constEnd())
+    return it.value();
+  const int index = m_states.size();
+  m_index.insert(key, index);
+  m_states.push_back(state);
+  m_formats.push_back(QTextCharFormat{});
+  m_built.push_back(false);
+  return index;
+}
+
+const QTextCharFormat& TermFormatTable::format(int index) const {
+  if (!m_built[index]) {
+    m_formats[index] = build(m_states[index]);
+    m_built[index] = true;
+  }
+  return m_formats[index];
+}
+
+const QVector<TermFormatTable::FontStyle>& TermFormatTable::fontStyles(const QString& family) const {
+  auto it = m_fontStyles.find(family);
+  if (it == m_fontStyles.end()) {
+    QVector<FontStyle> styles;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    for (const QString& style : QFontDatabase::styles(family))
+      styles.push_back({QFontDatabase::weight(family, style), QFontDatabase::italic(family, style)});
+#else
+    QFontDatabase fontDatabase;
+    for (const QString& style : fontDatabase.styles(family))
+      styles.push_back({fontDatabase.weight(family, style), fontDatabase.italic(family, style)});
+#endif
+    it = m_fontStyles.insert(family, styles);
+  }
+  return it.value();
+}
+
+QTextCharFormat TermFormatTable::build(const TermFormat& state) const {
+  QTextCharFormat format;
+  if (state.fontStyle != 0) {
+    // Alternate fonts pick a style of the family the console is drawn with
+    if (m_family.isEmpty())
+      m_family = QFontDatabase::systemFont(QFontDatabase::FixedFont).family();
+    const QVector<FontStyle>& styles = fontStyles(m_family);
+    const int styleIndex = state.fontStyle - 1;
+    if (styleIndex < styles.size()) {
+      format.setFontWeight(styles[styleIndex].weight);
+      format.setFontItalic(styles[styleIndex].italic);
+    }
+  }
+
+  switch (state.weight) {
+  case TermFormat::Weight::Default:
+    break;
+  case TermFormat::Weight::Light:
+    format.setFontWeight(QFont::Light);
+    break;
+  case TermFormat::Weight::Normal:
+    format.setFontWeight(QFont::Normal);
+    break;
+  case TermFormat::Weight::Bold:
+    format.setFontWeight(QFont::Bold);
+    break;
+  case TermFormat::Weight::Black:
+    format.setFontWeight(QFont::Black);
+    break;
+  }
+  if (state.italic)
+    format.setFontItalic(true);
+  if (state.underline) {
+    format.setUnderlineStyle(QTextCharFormat::SingleUnderline);
+    format.setFontUnderline(true);
+  }
+  if (state.strikeOut)
+    format.setFontStrikeOut(true);
+  if (state.foreground)
+    format.setForeground(QColor(QRgb(state.foreground)));
+  if (state.background)
+    format.setBackground(QColor(QRgb(state.background)));
+  return format;
+}
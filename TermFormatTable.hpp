@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QTextCharFormat>
+#include <QVector>
+
+#include "EscapeSequenceParser.hpp"
+
+/**
+ * Interns console SGR states and builds one QTextCharFormat per distinct state.
+ * hecl output cycles through a few dozen color combinations, so after warm-up every escape
+ * sequence resolves to an existing index with a single hash lookup. Indices are stable for the
+ * table's lifetime; index 0 is always the default state.
+ */
+class TermFormatTable {
+public:
+  TermFormatTable();
+
+  int intern(const TermFormat& state);
+  int size() const { return m_states.size(); }
+  const TermFormat& state(int index) const { return m_states[index]; }
+  // Built on first use
+  const QTextCharFormat& format(int index) const;
+
+private:
+  QTextCharFormat build(const TermFormat& state) const;
+  struct FontStyle {
+    int weight;
+    bool italic;
+  };
+  const QVector<FontStyle>& fontStyles(const QString& family) const;
+
+  QHash<quint64, int> m_index;
+  QVector<TermFormat> m_states;
+  mutable QVector<QTextCharFormat> m_formats;
+  mutable QVector<bool> m_built;
+  mutable QHash<QString, QVector<FontStyle>> m_fontStyles;
+  mutable QString m_family;
+};
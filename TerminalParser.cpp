@@ -0,0 +1,115 @@
+#include "TerminalParser.hpp"
+
+#include <algorithm>
+
+#include "EscapeSequenceParser.hpp"
+
+namespace {
+constexpr char16_t Bell = 0x07;
+constexpr char16_t Escape = 0x1B;
+
+/* Tabs are printed as-is; other C0 controls and DEL never reach the document */
+bool IsPrintable(char16_t c) { return (c >= 0x20 && c != 0x7F) || c == u'\t'; }
+} // namespace
+
+void TerminalParser::reset() {
+  m_state = State::Ground;
+  m_paramCount = 0;
+  m_privateMarker = false;
+  m_current = TermFormat{};
+  m_currentIndex = 0;
+}
+
+void TerminalParser::feed(const QChar* data, int len, Sink& sink) {
+  const QChar* p = data;
+  const QChar* const end = data + len;
+  while (p != end) {
+    if (m_state == State::Ground) {
+      const QChar* run = p;
+      while (p != end && IsPrintable(p->unicode()))
+        ++p;
+      if (p != run)
+        sink.text(run, int(p - run), m_currentIndex);
+      if (p == end)
+        break;
+    }
+
+    const char16_t c = (p++)->unicode();
+    switch (m_state) {
+    case State::Ground:
+      if (c == u'\r')
+        sink.carriageReturn();
+      else if (c == u'\n')
+        sink.lineFeed();
+      else if (c == Escape)
+        m_state = State::Escape;
+      break;
+    case State::Escape:
+      if (c == u'[') {
+        m_state = State::Csi;
+        m_paramCount = 0;
+        m_privateMarker = false;
+      } else if (c == u']') {
+        m_state = State::Osc;
+      } else if (c != Escape) {
+        // Two-character sequences (charset selection, keypad modes) have no visible effect
+        m_state = State::Ground;
+      }
+      break;
+    case State::Csi:
+      if (c >= u'0' && c <= u'9') {
+        if (m_paramCount == 0)
+          m_params[m_paramCount++] = 0;
+        int& param = m_params[m_paramCount - 1];
+        param = std::min(param * 10 + int(c - u'0'), 0xFFFF);
+      } else if (c == u';') {
+        if (m_paramCount == 0)
+          m_params[m_paramCount++] = 0;
+        if (m_paramCount < MaxParams)
+          m_params[m_paramCount++] = 0;
+      } else if (c >= 0x3C && c <= 0x3F) {
+        m_privateMarker = true;
+      } else if (c >= 0x40 && c <= 0x7E) {
+        m_state = State::Ground;
+        dispatchCsi(c, sink);
+      } else if (c == Escape) {
+        m_state = State::Escape;
+      }
+      // Intermediate bytes and stray controls inside a sequence are dropped
+      break;
+    case State::Osc:
+      // Window titles and the like; terminated by BEL or ST (ESC \)
+      if (c == Bell)
+        m_state = State::Ground;
+      else if (c == Escape)
+        m_state = State::Escape;
+      break;
+    }
+  }
+}
+
+void TerminalParser::dispatchCsi(char16_t final, Sink& sink) {
+  if (m_privateMarker)
+    return;
+
+  switch (final) {
+  case u'm': {
+    if (m_paramCount == 0)
+      m_params[m_paramCount++] = 0;
+    EscapeParamIterator i(m_params, m_params + m_paramCount);
+    while (i.hasNext()) {
+      const int attribute = i.next();
+      ParseEscapeSequence(attribute, i, m_current);
+    }
+    if (m_current != m_formats.state(m_currentIndex))
+      m_currentIndex = m_formats.intern(m_current);
+    break;
+  }
+  case u'A':
+  case u'F':
+    sink.cursorUp(m_paramCount > 0 && m_params[0] > 0 ? m_params[0] : 1);
+    break;
+  default:
+    break;
+  }
+}
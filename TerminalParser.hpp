@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QChar>
+
+#include "TermFormatTable.hpp"
+
+/**
+ * Incremental VT100 parser for hecl/urde console output.
+ * Parser state survives between feed() calls, so escape sequences and line endings split
+ * across process reads are handled correctly. Printable text is reported as spans pointing
+ * into the input along with the index of the format that applies to them in formats();
+ * SGR parameters are applied through ParseEscapeSequence.
+ */
+class TerminalParser {
+public:
+  class Sink {
+  public:
+    virtual ~Sink() = default;
+    virtual void text(const QChar* data, int len, int format) = 0;
+    virtual void carriageReturn() = 0;
+    virtual void lineFeed() = 0;
+    virtual void cursorUp(int lines) = 0;
+  };
+
+  TerminalParser() = default;
+
+  void feed(const QChar* data, int len, Sink& sink);
+  /* Returns to the ground state and default format; interned formats stay valid */
+  void reset();
+
+  int currentFormat() const { return m_currentIndex; }
+  // Also used to register formats for text written outside the parser, such as status notes
+  TermFormatTable& formats() { return m_formats; }
+  const TermFormatTable& formats() const { return m_formats; }
+
+private:
+  enum class State { Ground, Escape, Csi, Osc };
+  static constexpr int MaxParams = 16;
+
+  void dispatchCsi(char16_t final, Sink& sink);
+
+  State m_state = State::Ground;
+  int m_params[MaxParams] = {};
+  int m_paramCount = 0;
+  bool m_privateMarker = false;
+
+  TermFormat m_current;
+  int m_currentIndex = 0;
+  TermFormatTable m_formats;
+};
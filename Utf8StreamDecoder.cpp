@@ -0,0 +1,125 @@
+#include "Utf8StreamDecoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr char32_t ReplacementChar = 0xFFFD;
+
+/*
+ * Decodes one code point from p. Returns the number of bytes consumed, or 0 if the bytes
+ * available are a valid but incomplete prefix. Ill-formed input consumes its longest valid
+ * prefix (at least the lead byte) and yields U+FFFD.
+ */
+int DecodeOne(const uchar* p, qint64 avail, char32_t& cp) {
+  const uchar c = p[0];
+  if (c < 0x80) {
+    cp = c;
+    return 1;
+  }
+
+  int need;
+  char32_t value;
+  uchar lo = 0x80;
+  uchar hi = 0xBF;
+  if (c >= 0xC2 && c <= 0xDF) {
+    need = 2;
+    value = c & 0x1F;
+  } else if (c >= 0xE0 && c <= 0xEF) {
+    need = 3;
+    value = c & 0x0F;
+    if (c == 0xE0)
+      lo = 0xA0; // overlong
+    else if (c == 0xED)
+      hi = 0x9F; // surrogates
+  } else if (c >= 0xF0 && c <= 0xF4) {
+    need = 4;
+    value = c & 0x07;
+    if (c == 0xF0)
+      lo = 0x90; // overlong
+    else if (c == 0xF4)
+      hi = 0x8F; // beyond U+10FFFF
+  } else {
+    cp = ReplacementChar;
+    return 1;
+  }
+
+  for (int k = 1; k < need; ++k) {
+    if (k >= avail)
+      return 0;
+    const uchar b = p[k];
+    if (b < lo || b > hi) {
+      cp = ReplacementChar;
+      return k;
+    }
+    lo = 0x80;
+    hi = 0xBF;
+    value = (value << 6) | (b & 0x3F);
+  }
+  cp = value;
+  return need;
+}
+} // namespace
+
+void Utf8StreamDecoder::put(char32_t cp) {
+  if (cp >= 0x10000) {
+    cp -= 0x10000;
+    m_buf[m_bufLen++] = char16_t(0xD800 + (cp >> 10));
+    m_buf[m_bufLen++] = char16_t(0xDC00 + (cp & 0x3FF));
+  } else {
+    m_buf[m_bufLen++] = char16_t(cp);
+  }
+}
+
+const QChar* Utf8StreamDecoder::decode(const char* data, qint64 len, int* outLen) {
+  // Every byte yields at most one UTF-16 unit; ill-formed carry bytes add up to three more
+  if (m_buf.size() < size_t(len) + 4)
+    m_buf.resize(size_t(len) + 4);
+  m_bufLen = 0;
+
+  const auto* p = reinterpret_cast<const uchar*>(data);
+  const uchar* const end = p + len;
+  char32_t cp;
+
+  while (m_carryLen > 0 && p != end) {
+    uchar tmp[7];
+    const int extra = int(std::min<qint64>(end - p, 3));
+    std::memcpy(tmp, m_carry, size_t(m_carryLen));
+    std::memcpy(tmp + m_carryLen, p, size_t(extra));
+    const int used = DecodeOne(tmp, m_carryLen + extra, cp);
+    if (used == 0) {
+      // Still incomplete; everything left fits in the carry
+      std::memcpy(m_carry + m_carryLen, p, size_t(extra));
+      m_carryLen += extra;
+      p = end;
+      break;
+    }
+    put(cp);
+    if (used < m_carryLen) {
+      // Ill-formed carry; retry what remains of it
+      std::memmove(m_carry, m_carry + used, size_t(m_carryLen - used));
+      m_carryLen -= used;
+    } else {
+      p += used - m_carryLen;
+      m_carryLen = 0;
+    }
+  }
+
+  while (p != end) {
+    if (*p < 0x80) {
+      m_buf[m_bufLen++] = *p++;
+      continue;
+    }
+    const int used = DecodeOne(p, end - p, cp);
+    if (used == 0) {
+      m_carryLen = int(end - p);
+      std::memcpy(m_carry, p, size_t(m_carryLen));
+      break;
+    }
+    put(cp);
+    p += used;
+  }
+
+  *outLen = int(m_bufLen);
+  return reinterpret_cast<const QChar*>(m_buf.data());
+}
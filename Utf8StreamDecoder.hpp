@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+#include <QChar>
+#include <QtGlobal>
+
+/**
+ * UTF-8 to UTF-16 decoder for byte streams that arrive in arbitrary pieces.
+ * An incomplete sequence at the end of one chunk is carried over and completed by the next,
+ * instead of turning into replacement characters. Output goes to an internal buffer that is
+ * reused between calls, so decoding allocates nothing once the buffer has grown to the
+ * typical chunk size. Invalid input decodes to U+FFFD per maximal subpart.
+ */
+class Utf8StreamDecoder {
+public:
+  // The returned text stays valid until the next call
+  const QChar* decode(const char* data, qint64 len, int* outLen);
+  // Drops any partial sequence, e.g. when a new process starts
+  void reset() { m_carryLen = 0; }
+
+private:
+  void put(char32_t cp);
+
+  std::vector<char16_t> m_buf;
+  size_t m_bufLen = 0;
+  uchar m_carry[4] = {};
+  int m_carryLen = 0;
+};
@@ -0,0 +1,316 @@
+#include "ZipStreamExtractor.hpp"
+
+#include <algorithm>
+
+#include <QObject>
+
+namespace {
+constexpr quint32 LocalFileHeaderSig = 0x04034b50;
+constexpr quint32 DataDescriptorSig = 0x08074b50;
+constexpr quint32 CentralDirectorySig = 0x02014b50;
+constexpr quint32 Zip64EndOfCentralDirSig = 0x06064b50;
+constexpr quint32 EndOfCentralDirSig = 0x06054b50;
+constexpr int LocalFileHeaderSize = 30;
+
+constexpr quint16 FlagEncrypted = 0x1;
+constexpr quint16 FlagDataDescriptor = 0x8;
+constexpr quint16 FlagUtf8 = 0x800;
+
+constexpr quint16 MethodStored = 0;
+constexpr quint16 MethodDeflated = Z_DEFLATED;
+
+constexpr size_t InflateBufSize = 256 * 1024;
+
+quint16 ReadLE16(const char* p) {
+  const auto* u = reinterpret_cast<const uchar*>(p);
+  return quint16(u[0] | (u[1] << 8));
+}
+
+quint32 ReadLE32(const char* p) { return quint32(ReadLE16(p)) | (quint32(ReadLE16(p + 2)) << 16); }
+
+quint64 ReadLE64(const char* p) { return quint64(ReadLE32(p)) | (quint64(ReadLE32(p + 4)) << 32); }
+
+/* Tops up `record` to `need` bytes from the stream, returning how many were taken */
+qint64 Accumulate(QByteArray& record, int need, const char* data, qint64 len) {
+  const qint64 take = std::min<qint64>(len, need - record.size());
+  if (take > 0)
+    record.append(data, int(take));
+  return std::max<qint64>(take, 0);
+}
+} // namespace
+
+ZipStreamExtractor::ZipStreamExtractor(const QString& dir)
+: m_dir(dir), m_root(QDir::cleanPath(m_dir.absolutePath())), m_inflateBuf(InflateBufSize) {}
+
+ZipStreamExtractor::~ZipStreamExtractor() {
+  if (m_zstreamInit)
+    inflateEnd(&m_zstream);
+  if (m_out.isOpen()) {
+    m_out.close();
+    m_out.remove();
+  }
+}
+
+bool ZipStreamExtractor::feed(const char* data, qint64 len) {
+  while (len > 0) {
+    qint64 consumed = 0;
+    switch (m_state) {
+    case State::Header:
+      consumed = consumeHeader(data, len);
+      break;
+    case State::Data:
+      consumed = consumeData(data, len);
+      break;
+    case State::Descriptor:
+      consumed = consumeDescriptor(data, len);
+      break;
+    case State::Done:
+      // Central directory follows; nothing left to extract
+      return true;
+    case State::Error:
+      return false;
+    }
+    data += consumed;
+    len -= consumed;
+  }
+  return m_state != State::Error;
+}
+
+bool ZipStreamExtractor::finish() {
+  if (m_state == State::Done)
+    return true;
+  if (m_state != State::Error)
+    setError(QObject::tr("Archive ended before its central directory"));
+  return false;
+}
+
+qint64 ZipStreamExtractor::consumeHeader(const char* data, qint64 len) {
+  qint64 consumed = Accumulate(m_record, 4, data, len);
+  if (m_record.size() < 4)
+    return consumed;
+
+  const quint32 sig = ReadLE32(m_record.constData());
+  if (sig == CentralDirectorySig || sig == Zip64EndOfCentralDirSig || sig == EndOfCentralDirSig) {
+    m_state = State::Done;
+    return consumed;
+  }
+  if (sig != LocalFileHeaderSig) {
+    setError(QObject::tr("Unexpected zip record 0x%1").arg(sig, 8, 16, QLatin1Char{'0'}));
+    return consumed;
+  }
+
+  consumed += Accumulate(m_record, LocalFileHeaderSize, data + consumed, len - consumed);
+  if (m_record.size() < LocalFileHeaderSize)
+    return consumed;
+
+  const int nameLen = ReadLE16(m_record.constData() + 26);
+  const int extraLen = ReadLE16(m_record.constData() + 28);
+  consumed += Accumulate(m_record, LocalFileHeaderSize + nameLen + extraLen, data + consumed, len - consumed);
+  if (m_record.size() < LocalFileHeaderSize + nameLen + extraLen)
+    return consumed;
+
+  if (beginEntry())
+    m_record.clear();
+  return consumed;
+}
+
+bool ZipStreamExtractor::beginEntry() {
+  const char* hdr = m_record.constData();
+  m_flags = ReadLE16(hdr + 6);
+  m_method = ReadLE16(hdr + 8);
+  m_expectedCrc = ReadLE32(hdr + 14);
+  m_compressedRemaining = ReadLE32(hdr + 18);
+  m_expectedSize = ReadLE32(hdr + 22);
+  const int nameLen = ReadLE16(hdr + 26);
+  const int extraLen = ReadLE16(hdr + 28);
+
+  const QByteArray rawName(hdr + LocalFileHeaderSize, nameLen);
+  const QString name = (m_flags & FlagUtf8) ? QString::fromUtf8(rawName) : QString::fromLocal8Bit(rawName);
+
+  m_zip64 = false;
+  const char* extra = hdr + LocalFileHeaderSize + nameLen;
+  for (int off = 0; off + 4 <= extraLen;) {
+    const quint16 id = ReadLE16(extra + off);
+    const quint16 size = ReadLE16(extra + off + 2);
+    if (id == 0x0001) {
+      m_zip64 = true;
+      int field = off + 4;
+      if (m_expectedSize == 0xFFFFFFFF && field + 8 <= off + 4 + size) {
+        m_expectedSize = ReadLE64(extra + field);
+        field += 8;
+      }
+      if (m_compressedRemaining == 0xFFFFFFFF && field + 8 <= off + 4 + size)
+        m_compressedRemaining = ReadLE64(extra + field);
+    }
+    off += 4 + size;
+  }
+
+  if (m_flags & FlagEncrypted) {
+    setError(QObject::tr("Encrypted entry %1 is not supported").arg(name));
+    return false;
+  }
+  if (m_method != MethodStored && m_method != MethodDeflated) {
+    setError(QObject::tr("Unsupported compression method %1 for %2").arg(m_method).arg(name));
+    return false;
+  }
+  if (m_method == MethodStored && (m_flags & FlagDataDescriptor)) {
+    setError(QObject::tr("Stored entry %1 has no size in its local header").arg(name));
+    return false;
+  }
+
+  const QString path = QDir::cleanPath(m_dir.absoluteFilePath(name));
+  if (!path.startsWith(m_root + QLatin1Char{'/'})) {
+    setError(QObject::tr("Entry %1 escapes the destination directory").arg(name));
+    return false;
+  }
+
+  if (name.endsWith(QLatin1Char{'/'})) {
+    if (!QDir().mkpath(path)) {
+      setError(QObject::tr("Unable to create %1").arg(path));
+      return false;
+    }
+    // Directory entries carry no data
+    m_state = State::Header;
+    return true;
+  }
+
+  if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+    setError(QObject::tr("Unable to create %1").arg(QFileInfo(path).absolutePath()));
+    return false;
+  }
+  m_out.setFileName(path);
+  if (!m_out.open(QIODevice::WriteOnly)) {
+    setError(QObject::tr("Unable to write %1").arg(path));
+    return false;
+  }
+
+  m_crc = crc32(0, nullptr, 0);
+  m_written = 0;
+  if (m_method == MethodDeflated) {
+    if (m_zstreamInit) {
+      inflateReset(&m_zstream);
+    } else {
+      m_zstream = {};
+      if (inflateInit2(&m_zstream, -MAX_WBITS) != Z_OK) {
+        setError(QObject::tr("Unable to initialize inflate"));
+        return false;
+      }
+      m_zstreamInit = true;
+    }
+  }
+
+  m_state = State::Data;
+  if (m_method == MethodStored && m_compressedRemaining == 0)
+    endEntry(m_expectedCrc, m_expectedSize);
+  return true;
+}
+
+bool ZipStreamExtractor::writeOutput(const char* data, qint64 len) {
+  if (m_out.write(data, len) != len) {
+    setError(QObject::tr("Unable to write %1").arg(m_out.fileName()));
+    return false;
+  }
+  m_crc = crc32(m_crc, reinterpret_cast<const Bytef*>(data), uInt(len));
+  m_written += quint64(len);
+  return true;
+}
+
+qint64 ZipStreamExtractor::consumeData(const char* data, qint64 len) {
+  const bool sized = !(m_flags & FlagDataDescriptor);
+  const qint64 avail = sized ? qint64(std::min<quint64>(quint64(len), m_compressedRemaining)) : len;
+
+  if (m_method == MethodStored) {
+    if (!writeOutput(data, avail))
+      return avail;
+    m_compressedRemaining -= quint64(avail);
+    if (m_compressedRemaining == 0)
+      endEntry(m_expectedCrc, m_expectedSize);
+    return avail;
+  }
+
+  // zlib counts in uInt; large feeds are handled over several calls of the feed() loop
+  const uInt take = uInt(std::min<qint64>(avail, 0x40000000));
+  m_zstream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  m_zstream.avail_in = take;
+  int ret = Z_OK;
+  do {
+    m_zstream.next_out = reinterpret_cast<Bytef*>(m_inflateBuf.data());
+    m_zstream.avail_out = uInt(m_inflateBuf.size());
+    ret = inflate(&m_zstream, Z_NO_FLUSH);
+    if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+      setError(QObject::tr("Corrupt data in %1").arg(m_out.fileName()));
+      return take;
+    }
+    const qint64 produced = qint64(m_inflateBuf.size() - m_zstream.avail_out);
+    if (produced > 0 && !writeOutput(m_inflateBuf.data(), produced))
+      return take;
+  } while (ret == Z_OK && (m_zstream.avail_in > 0 || m_zstream.avail_out == 0));
+
+  const qint64 consumed = qint64(take - m_zstream.avail_in);
+  if (consumed == 0 && ret == Z_BUF_ERROR) {
+    setError(QObject::tr("Corrupt data in %1").arg(m_out.fileName()));
+    return 0;
+  }
+  if (sized)
+    m_compressedRemaining -= quint64(consumed);
+
+  if (ret == Z_STREAM_END) {
+    if (sized && m_compressedRemaining != 0) {
+      setError(QObject::tr("Corrupt data in %1").arg(m_out.fileName()));
+    } else if (sized) {
+      endEntry(m_expectedCrc, m_expectedSize);
+    } else {
+      m_state = State::Descriptor;
+    }
+  } else if (sized && m_compressedRemaining == 0) {
+    setError(QObject::tr("Corrupt data in %1").arg(m_out.fileName()));
+  }
+  return consumed;
+}
+
+qint64 ZipStreamExtractor::consumeDescriptor(const char* data, qint64 len) {
+  // The descriptor signature is optional; sizes widen to 64 bits for zip64 entries
+  qint64 consumed = Accumulate(m_record, 4, data, len);
+  if (m_record.size() < 4)
+    return consumed;
+
+  const int sigLen = ReadLE32(m_record.constData()) == DataDescriptorSig ? 4 : 0;
+  const int sizeLen = m_zip64 ? 8 : 4;
+  const int need = sigLen + 4 + sizeLen * 2;
+  consumed += Accumulate(m_record, need, data + consumed, len - consumed);
+  if (m_record.size() < need)
+    return consumed;
+
+  const char* desc = m_record.constData() + sigLen;
+  const quint32 crc = ReadLE32(desc);
+  const quint64 size = m_zip64 ? ReadLE64(desc + 12) : ReadLE32(desc + 8);
+  m_record.clear();
+  endEntry(crc, size);
+  return consumed;
+}
+
+void ZipStreamExtractor::endEntry(quint32 crc, quint64 uncompressedSize) {
+  m_out.close();
+  if (m_out.error() != QFileDevice::NoError) {
+    setError(QObject::tr("Unable to write %1").arg(m_out.fileName()));
+    return;
+  }
+  if (crc != m_crc || uncompressedSize != m_written) {
+    setError(QObject::tr("CRC mismatch in %1").arg(m_out.fileName()));
+    return;
+  }
+
+  m_extracted.push_back(m_out.fileName());
+  m_state = State::Header;
+  if (m_fileExtractedHandler)
+    m_fileExtractedHandler(m_out.fileName());
+}
+
+void ZipStreamExtractor::setError(const QString& error) {
+  m_state = State::Error;
+  m_error = error;
+  if (m_out.isOpen()) {
+    m_out.close();
+    m_out.remove();
+  }
+}
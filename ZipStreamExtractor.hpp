@@ -0,0 +1,69 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+
+#include <zlib.h>
+
+/**
+ * Extracts a zip archive from a forward-only byte stream by walking its local file headers,
+ * so entries are written while later parts of the archive are still being downloaded.
+ * Unix permissions only exist in the central directory; apply them with
+ * ExtractZip::applyPermissions once the whole archive is available.
+ */
+class ZipStreamExtractor {
+public:
+  explicit ZipStreamExtractor(const QString& dir);
+  ~ZipStreamExtractor();
+  ZipStreamExtractor(const ZipStreamExtractor&) = delete;
+  ZipStreamExtractor& operator=(const ZipStreamExtractor&) = delete;
+
+  void setFileExtractedHandler(std::function<void(const QString& path)>&& handler) {
+    m_fileExtractedHandler = std::move(handler);
+  }
+
+  bool feed(const char* data, qint64 len);
+  bool finish();
+
+  bool hasError() const { return m_state == State::Error; }
+  const QString& errorString() const { return m_error; }
+  const QStringList& extractedFiles() const { return m_extracted; }
+
+private:
+  enum class State { Header, Data, Descriptor, Done, Error };
+
+  qint64 consumeHeader(const char* data, qint64 len);
+  qint64 consumeData(const char* data, qint64 len);
+  qint64 consumeDescriptor(const char* data, qint64 len);
+  bool beginEntry();
+  bool writeOutput(const char* data, qint64 len);
+  void endEntry(quint32 crc, quint64 uncompressedSize);
+  void setError(const QString& error);
+
+  QDir m_dir;
+  QString m_root;
+  State m_state = State::Header;
+  QString m_error;
+  QStringList m_extracted;
+  std::function<void(const QString& path)> m_fileExtractedHandler;
+
+  QByteArray m_record;
+  QFile m_out;
+  quint16 m_flags = 0;
+  quint16 m_method = 0;
+  quint32 m_expectedCrc = 0;
+  quint64 m_compressedRemaining = 0;
+  quint64 m_expectedSize = 0;
+  bool m_zip64 = false;
+
+  quint32 m_crc = 0;
+  quint64 m_written = 0;
+  z_stream m_zstream = {};
+  bool m_zstreamInit = false;
+  std::vector<char> m_inflateBuf;
+};
@@ -11,6 +11,7 @@ Q_IMPORT_PLUGIN(QWindowsIntegrationPlugin);
 #include <QStyleFactory>
 #include "MainWindow.hpp"
 #include "Common.hpp"
+#include "HeadlessRunner.hpp"
 
 extern "C" const uint8_t MAINICON_QT[];
 
@@ -37,6 +38,11 @@ int main(int argc, char* argv[]) {
   QApplication::setOrganizationName(QStringLiteral("AxioDL"));
   QApplication::setApplicationName(QStringLiteral("HECL"));
 
+  // Batch mode never touches a display, so it has to be picked before any QApplication exists
+  for (int i = 1; i < argc; ++i)
+    if (qstrcmp(argv[i], "--headless") == 0)
+      return HeadlessRunner::exec(argc, argv);
+
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 6, 0) && QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
   QApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
   QApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);